@@ -0,0 +1,182 @@
+#include "OrtAsyncInference.h"
+#include <stdexcept>
+
+struct OrtAsyncInference::Request
+{
+    OrtAsyncInference *owner;
+    std::vector<float> input;
+    size_t batch_size;
+    OrtValue *input_value;
+    OrtValue *output_value;
+    OrtBatchCallback callback;
+    uint64_t submit_ns;
+};
+
+OrtAsyncInference::OrtAsyncInference(const OrtInference &inference, size_t fallbackThreads)
+    : inference(inference)
+{
+    fallback_thread_count = fallbackThreads > 0 ? fallbackThreads : 1;
+    stopping = false;
+    in_flight = 0;
+#if ORT_API_VERSION >= 16
+    use_run_async = inference.runtime->ApiVersion() >= 16;
+#else
+    use_run_async = false;
+#endif
+    if (!use_run_async)
+        StartFallbackWorkers();
+}
+
+OrtAsyncInference::~OrtAsyncInference()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (size_t i = 0; i < fallback_workers.size(); i++)
+        fallback_workers[i].join();
+}
+
+bool OrtAsyncInference::UsesRunAsync() const
+{
+    return use_run_async;
+}
+
+void OrtAsyncInference::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_cv.wait(lock, [this]
+                 { return in_flight == 0; });
+}
+
+void OrtAsyncInference::StartFallbackWorkers()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!fallback_workers.empty())
+        return;
+    for (size_t i = 0; i < fallback_thread_count; i++)
+        fallback_workers.emplace_back(&OrtAsyncInference::FallbackLoop, this);
+}
+
+void OrtAsyncInference::Submit(const float *inputData, size_t batchSize, OrtBatchCallback callback)
+{
+    if (batchSize == 0)
+    {
+        printf("Submit needs at least one row.\n");
+        callback(false, OrtBatchResult());
+        return;
+    }
+
+    Request *request = new Request();
+    request->owner = this;
+    request->batch_size = batchSize;
+    request->output_value = NULL;
+    request->callback = std::move(callback);
+    request->input_value = NULL;
+    uint64_t start = inference.StageClock();
+
+    // The row length is whatever the input tensor expects; copy that many floats.
+    size_t row_element_count = inference.InputRowElementCount();
+    request->input.assign(inputData, inputData + batchSize * row_element_count);
+    request->input_value = inference.CreateBatchInput(request->input.data(), batchSize);
+    request->submit_ns = inference.RecordStage(OrtStagePrepare, start);
+    in_flight++;
+
+#if ORT_API_VERSION >= 16
+    if (use_run_async)
+    {
+        OrtStatus *status = ort_api->RunAsync(inference.session, inference.BatchRunOptions(request->batch_size), inference.input_names, (const OrtValue *const *)&request->input_value, 1,
+                                              inference.output_names, 1, &request->output_value, RunAsyncCallback, request);
+        if (!status)
+            return;
+        printf("RunAsync unavailable (%s), using wrapper threads.\n", ort_api->GetErrorMessage(status));
+        ort_api->ReleaseStatus(status);
+        use_run_async = false;
+        StartFallbackWorkers();
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fallback_queue.push_back(request);
+    }
+    work_cv.notify_one();
+}
+
+std::future<OrtBatchResult> OrtAsyncInference::Submit(const float *inputData, size_t batchSize)
+{
+    std::shared_ptr<std::promise<OrtBatchResult>> promise = std::make_shared<std::promise<OrtBatchResult>>();
+    std::future<OrtBatchResult> result = promise->get_future();
+    Submit(inputData, batchSize, [promise](bool ok, const OrtBatchResult &batch)
+           {
+        if (ok)
+            promise->set_value(batch);
+        else
+            promise->set_exception(std::make_exception_ptr(std::runtime_error("onnxruntime run failed"))); });
+    return result;
+}
+
+#if ORT_API_VERSION >= 16
+void OrtAsyncInference::RunAsyncCallback(void *user_data, OrtValue **outputs, size_t num_outputs, OrtStatusPtr status)
+{
+    Request *request = static_cast<Request *>(user_data);
+    bool ok = (status == NULL);
+    if (!ok)
+    {
+        printf("Got onnxruntime error %s (RunAsync)\n", ort_api->GetErrorMessage(status));
+        ort_api->ReleaseStatus(status);
+    }
+    // RunAsync queues on ORT's pool, so the Run stage includes that wait.
+    request->owner->inference.RecordStage(OrtStageRun, request->submit_ns);
+    request->owner->Complete(request, (ok && num_outputs > 0) ? outputs[0] : NULL, ok);
+}
+#endif
+
+void OrtAsyncInference::FallbackLoop()
+{
+    while (true)
+    {
+        Request *request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_cv.wait(lock, [this]
+                         { return stopping || !fallback_queue.empty(); });
+            if (fallback_queue.empty())
+                return;
+            request = fallback_queue.front();
+            fallback_queue.pop_front();
+        }
+        uint64_t start = inference.RecordStage(OrtStageQueueWait, request->submit_ns);
+
+        OrtStatus *status = ort_api->Run(inference.session, inference.BatchRunOptions(request->batch_size), inference.input_names, (const OrtValue *const *)&request->input_value, 1,
+                                         inference.output_names, 1, &request->output_value);
+        bool ok = (status == NULL);
+        if (!ok)
+        {
+            printf("Got onnxruntime error %s (Run)\n", ort_api->GetErrorMessage(status));
+            ort_api->ReleaseStatus(status);
+        }
+        inference.RecordStage(OrtStageRun, start);
+        Complete(request, request->output_value, ok);
+    }
+}
+
+void OrtAsyncInference::Complete(Request *request, OrtValue *output, bool ok)
+{
+    uint64_t start = inference.StageClock();
+    OrtBatchResult result;
+    if (ok && output)
+        result.stride = inference.ReadBatchOutput(output, request->batch_size, result.values);
+    inference.RecordStage(OrtStageProcess, start);
+    request->callback(ok && output && result.stride > 0, result);
+
+    ort_api->ReleaseValue(output);
+    ort_api->ReleaseValue(request->input_value);
+    delete request;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--in_flight == 0)
+        idle_cv.notify_all();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "OrtInference.h"
+
+struct OrtBatchResult
+{
+    std::vector<float> values;
+    size_t stride = 0;
+};
+
+// Called once per submitted batch with the same layout RunBatchInference returns. ok is
+// false when the batch is empty, the run failed or its output cannot be read as floats; the
+// error has been printed.
+typedef std::function<void(bool ok, const OrtBatchResult &result)> OrtBatchCallback;
+
+// Non-blocking batched inference. When the loaded library has RunAsync (API 16+) the run
+// happens on ORT's intra-op pool and the callback fires from there. Otherwise, or if ORT
+// refuses RunAsync for this session (it needs an intra-op pool of 2+ threads), requests
+// run on a small wrapper-side thread pool instead.
+class OrtAsyncInference
+{
+private:
+    struct Request;
+
+    const OrtInference &inference;
+    std::atomic<bool> use_run_async;
+    std::atomic<size_t> in_flight;
+    std::mutex mutex;
+    std::condition_variable idle_cv;
+    std::condition_variable work_cv;
+    std::deque<Request *> fallback_queue;
+    std::vector<std::thread> fallback_workers;
+    size_t fallback_thread_count;
+    bool stopping;
+
+    void StartFallbackWorkers();
+    void FallbackLoop();
+    void Complete(Request *request, OrtValue *output, bool ok);
+#if ORT_API_VERSION >= 16
+    static void RunAsyncCallback(void *user_data, OrtValue **outputs, size_t num_outputs, OrtStatusPtr status);
+#endif
+
+public:
+    OrtAsyncInference(const OrtInference &inference, size_t fallbackThreads = 2);
+    OrtAsyncInference(const OrtAsyncInference &) = delete;
+    OrtAsyncInference &operator=(const OrtAsyncInference &) = delete;
+    ~OrtAsyncInference();
+    // inputData is copied, so the caller's buffer can be reused as soon as this returns.
+    void Submit(const float *inputData, size_t batchSize, OrtBatchCallback callback);
+    std::future<OrtBatchResult> Submit(const float *inputData, size_t batchSize);
+    bool UsesRunAsync() const;
+    // Blocks until every submitted batch has completed.
+    void Wait();
+};
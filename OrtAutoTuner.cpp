@@ -0,0 +1,305 @@
+#include "OrtAutoTuner.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+static const char *ObjectiveName(int objective)
+{
+    return objective == 1 ? "throughput" : "p99";
+}
+
+// 1, 2, 4, ... below the hardware thread count, then the count itself.
+static std::vector<int> DefaultThreadCounts()
+{
+    int hardware_threads = (int)std::thread::hardware_concurrency();
+    if (hardware_threads < 1)
+        hardware_threads = 1;
+    std::vector<int> counts;
+    for (int count = 1; count < hardware_threads; count *= 2)
+        counts.push_back(count);
+    counts.push_back(hardware_threads);
+    return counts;
+}
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    // Nearest rank.
+    size_t rank = (size_t)ceil(fraction * values.size());
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+static bool ReadModelKey(const char *modelPath, uint64_t &key)
+{
+    OrtMappedFile model_file;
+    if (!model_file.Open(modelPath))
+        return false;
+    key = HashBytes(model_file.Data(), model_file.Size());
+    return true;
+}
+
+static uint64_t MachineKey(const std::string &machine)
+{
+    return HashBytes(machine.data(), machine.size());
+}
+
+OrtAutoTuner::OrtAutoTuner(const OrtTuningConfig &config)
+    : config(config)
+{
+}
+
+OrtTuningResult OrtAutoTuner::Tune(const char *modelPath) const
+{
+    OrtTuningResult result;
+    // Held for the whole sweep so the library and env are not reloaded for every candidate.
+    OrtRuntime *runtime = OrtRuntime::Acquire();
+    // Acquire has printed why the library could not be loaded; the result stays invalid.
+    if (!runtime)
+        return result;
+    result.machine = MachineDescription(runtime->VersionString());
+    result.objective = config.objective;
+    result.batch_sizes = config.batch_sizes;
+
+    OrtSessionConfig best = config.session_config;
+    best.tuning_file.clear();
+    std::vector<double> base_p99;
+    std::vector<double> base_throughput;
+    if (!Measure(modelPath, best, base_p99, base_throughput))
+    {
+        printf("Cannot synthesize inputs of %s for the requested batch sizes.\n", modelPath);
+        OrtRuntime::Release();
+        return result;
+    }
+    result.candidates = 1;
+    result.score = 1;
+    result.p99_latency_us = base_p99;
+    result.throughput = base_throughput;
+
+    std::vector<int> intra_threads = config.intra_op_num_threads.empty() ? DefaultThreadCounts() : config.intra_op_num_threads;
+    std::vector<int> inter_threads = config.inter_op_num_threads.empty() ? DefaultThreadCounts() : config.inter_op_num_threads;
+    struct Dimension
+    {
+        const char *name;
+        int OrtSessionConfig::*field;
+        const std::vector<int> *values;
+    };
+    const Dimension dimensions[] = {
+        {"graph_optimization_level", &OrtSessionConfig::graph_optimization_level, &config.graph_optimization_levels},
+        {"execution_mode", &OrtSessionConfig::execution_mode, &config.execution_modes},
+        {"intra_op_num_threads", &OrtSessionConfig::intra_op_num_threads, &intra_threads},
+        {"inter_op_num_threads", &OrtSessionConfig::inter_op_num_threads, &inter_threads},
+        {"allow_spinning", &OrtSessionConfig::allow_spinning, &config.allow_spinning},
+        {"memory_pattern", &OrtSessionConfig::memory_pattern, &config.memory_pattern},
+    };
+
+    for (const Dimension &dimension : dimensions)
+    {
+        if (dimension.field == &OrtSessionConfig::inter_op_num_threads && best.execution_mode != ORT_PARALLEL)
+            continue;
+        for (size_t v = 0; v < dimension.values->size(); v++)
+        {
+            int value = (*dimension.values)[v];
+            if (best.*dimension.field == value)
+                continue;
+            OrtSessionConfig candidate = best;
+            candidate.*dimension.field = value;
+            std::vector<double> p99;
+            std::vector<double> throughput;
+            if (!Measure(modelPath, candidate, p99, throughput))
+                continue;
+            result.candidates++;
+            double score = Score(p99, throughput, base_p99, base_throughput);
+            printf("%s=%d: score %.3f\n", dimension.name, value, score);
+            if (score < result.score * (1 - config.min_improvement))
+            {
+                best = candidate;
+                result.score = score;
+                result.p99_latency_us = p99;
+                result.throughput = throughput;
+            }
+        }
+    }
+
+    result.session_config = best;
+    result.valid = true;
+    OrtRuntime::Release();
+    return result;
+}
+
+// Loads the model with sessionConfig and measures every batch size. Returns false when inputs
+// cannot be synthesized for one of them.
+bool OrtAutoTuner::Measure(const char *modelPath, const OrtSessionConfig &sessionConfig, std::vector<double> &p99LatencyUs, std::vector<double> &throughput) const
+{
+    OrtInference inference;
+    inference.LoadONNXRuntimeLibrary();
+    inference.InitializeONNXEnvironment();
+    inference.CreateSessionAndLoadModel(modelPath, sessionConfig);
+    inference.GetInputOutputInfo();
+
+    p99LatencyUs.clear();
+    throughput.clear();
+    for (size_t b = 0; b < config.batch_sizes.size(); b++)
+    {
+        size_t batch_size = config.batch_sizes[b];
+        inference.MeasureRuns(batch_size, config.warmup_runs);
+        std::vector<double> latencies = inference.MeasureRuns(batch_size, config.runs);
+        if (latencies.empty())
+            return false;
+        double total_us = 0;
+        for (size_t i = 0; i < latencies.size(); i++)
+            total_us += latencies[i];
+        p99LatencyUs.push_back(Percentile(latencies, 0.99));
+        throughput.push_back(total_us > 0 ? batch_size * latencies.size() * 1e6 / total_us : 0);
+    }
+    return true;
+}
+
+// Mean over the batch sizes of the objective relative to the defaults, oriented so that lower
+// is better for both objectives.
+double OrtAutoTuner::Score(const std::vector<double> &p99LatencyUs, const std::vector<double> &throughput, const std::vector<double> &baseP99LatencyUs, const std::vector<double> &baseThroughput) const
+{
+    double score = 0;
+    for (size_t b = 0; b < p99LatencyUs.size(); b++)
+    {
+        if (config.objective == 1)
+            score += throughput[b] > 0 ? baseThroughput[b] / throughput[b] : 1;
+        else
+            score += baseP99LatencyUs[b] > 0 ? p99LatencyUs[b] / baseP99LatencyUs[b] : 1;
+    }
+    return p99LatencyUs.empty() ? 1 : score / p99LatencyUs.size();
+}
+
+// One line per result:
+// <model key> <machine key> name=value ... # <model path> on <machine>
+bool OrtAutoTuner::SaveTunedConfig(const char *tuningFile, const char *modelPath, const OrtTuningResult &result)
+{
+    uint64_t model_key = 0;
+    if (!result.valid || !ReadModelKey(modelPath, model_key))
+        return false;
+    FILE *file = fopen(tuningFile, "a");
+    if (!file)
+    {
+        printf("Failed to open tuning file %s\n", tuningFile);
+        return false;
+    }
+    const OrtSessionConfig &tuned = result.session_config;
+    fprintf(file, "%016llx %016llx intra_op_num_threads=%d inter_op_num_threads=%d execution_mode=%d graph_optimization_level=%d allow_spinning=%d memory_pattern=%d objective=%s score=%.4f # %s on %s\n",
+            (unsigned long long)model_key, (unsigned long long)MachineKey(result.machine),
+            tuned.intra_op_num_threads, tuned.inter_op_num_threads, tuned.execution_mode, tuned.graph_optimization_level,
+            tuned.allow_spinning, tuned.memory_pattern, ObjectiveName(result.objective), result.score, modelPath, result.machine.c_str());
+    bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
+
+bool OrtAutoTuner::ApplyTunedConfig(const char *tuningFile, const char *modelPath, const char *ortVersion, OrtSessionConfig &config)
+{
+    FILE *file = fopen(tuningFile, "r");
+    if (!file)
+        return false;
+    uint64_t model_key = 0;
+    if (!ReadModelKey(modelPath, model_key))
+    {
+        fclose(file);
+        return false;
+    }
+    uint64_t machine_key = MachineKey(MachineDescription(ortVersion));
+
+    OrtSessionConfig tuned = config;
+    bool found = false;
+    char line[4096];
+    while (fgets(line, sizeof(line), file))
+    {
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        unsigned long long line_model_key = 0;
+        unsigned long long line_machine_key = 0;
+        int consumed = 0;
+        if (sscanf(line, "%llx %llx%n", &line_model_key, &line_machine_key, &consumed) != 2)
+            continue;
+        if (line_model_key != model_key || line_machine_key != machine_key)
+            continue;
+
+        OrtSessionConfig entry = config;
+        const struct
+        {
+            const char *name;
+            int OrtSessionConfig::*field;
+        } fields[] = {
+            {"intra_op_num_threads", &OrtSessionConfig::intra_op_num_threads},
+            {"inter_op_num_threads", &OrtSessionConfig::inter_op_num_threads},
+            {"execution_mode", &OrtSessionConfig::execution_mode},
+            {"graph_optimization_level", &OrtSessionConfig::graph_optimization_level},
+            {"allow_spinning", &OrtSessionConfig::allow_spinning},
+            {"memory_pattern", &OrtSessionConfig::memory_pattern},
+        };
+        // Models load from several threads at once (preloading, session pools), so the
+        // settings are split without strtok's shared state.
+        std::istringstream tokens(line + consumed);
+        std::string token;
+        while (tokens >> token)
+        {
+            size_t equals = token.find('=');
+            if (equals == std::string::npos)
+                continue;
+            for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+            {
+                if (token.compare(0, equals, fields[f].name) == 0)
+                    entry.*fields[f].field = atoi(token.c_str() + equals + 1);
+            }
+        }
+        tuned = entry;
+        found = true;
+    }
+    fclose(file);
+    if (found)
+        config = tuned;
+    return found;
+}
+
+// CPU model, hardware thread count and ORT version; tuned settings do not carry over when
+// any of them changes.
+std::string OrtAutoTuner::MachineDescription(const char *ortVersion)
+{
+    std::string cpu;
+#ifdef _WIN32
+    const char *identifier = getenv("PROCESSOR_IDENTIFIER");
+    if (identifier)
+        cpu = identifier;
+#else
+    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
+    if (cpuinfo)
+    {
+        // x86 reports a model name; ARM only its implementer and part numbers.
+        std::string implementer;
+        std::string part;
+        char line[512];
+        while (fgets(line, sizeof(line), cpuinfo) && cpu.empty())
+        {
+            char *colon = strchr(line, ':');
+            if (!colon)
+                continue;
+            std::string value = colon + 1;
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t\r\n") + 1);
+            if (strncmp(line, "model name", 10) == 0)
+                cpu = value;
+            else if (strncmp(line, "CPU implementer", 15) == 0 && implementer.empty())
+                implementer = value;
+            else if (strncmp(line, "CPU part", 8) == 0 && part.empty())
+                part = value;
+        }
+        fclose(cpuinfo);
+        if (cpu.empty() && !implementer.empty())
+            cpu = "implementer " + implementer + " part " + part;
+    }
+#endif
+    if (cpu.empty())
+        cpu = "unknown cpu";
+    return cpu + ", " + std::to_string(std::thread::hardware_concurrency()) + " threads, onnxruntime " + ortVersion;
+}
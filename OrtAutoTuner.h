@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "OrtInference.h"
+
+// What OrtAutoTuner sweeps and how it judges a candidate. Empty thread lists try 1, 2, 4, ...
+// up to the hardware thread count.
+struct OrtTuningConfig
+{
+    // Options every candidate starts from; the tuned fields are overwritten per candidate.
+    OrtSessionConfig session_config;
+    std::vector<size_t> batch_sizes = {1};
+    // 0 minimizes the p99 latency, 1 maximizes throughput (rows per second).
+    int objective = 0;
+    std::vector<int> graph_optimization_levels = {ORT_ENABLE_BASIC, ORT_ENABLE_EXTENDED, ORT_ENABLE_ALL};
+    std::vector<int> execution_modes = {ORT_SEQUENTIAL, ORT_PARALLEL};
+    std::vector<int> intra_op_num_threads;
+    // Only swept when ORT_PARALLEL wins the execution mode.
+    std::vector<int> inter_op_num_threads;
+    std::vector<int> allow_spinning = {1, 0};
+    std::vector<int> memory_pattern = {1, 0};
+    // Runs per batch size before and during the measurement of each candidate.
+    size_t warmup_runs = 10;
+    size_t runs = 100;
+    // A candidate replaces the current best only when its score is lower by this fraction,
+    // so run-to-run noise does not flip settings.
+    double min_improvement = 0.05;
+};
+
+// Outcome of OrtAutoTuner::Tune. score is the objective relative to the ORT defaults, averaged
+// over the batch sizes (lower is better, 1 = no gain); the per-batch figures are for
+// session_config.
+struct OrtTuningResult
+{
+    bool valid = false;
+    OrtSessionConfig session_config;
+    std::string machine;
+    int objective = 0;
+    double score = 0;
+    size_t candidates = 0;
+    std::vector<size_t> batch_sizes;
+    std::vector<double> p99_latency_us;
+    std::vector<double> throughput;
+};
+
+// Finds session options for one model on the current machine. Starting from the ORT
+// defaults, it makes one coordinate-descent pass over optimization level, execution mode,
+// intra/inter-op threads, spinning and memory pattern, loading every candidate as a fresh
+// session on synthesized inputs. Results are appended to a text tuning file keyed by the
+// model contents and the machine (CPU, hardware threads, ORT version); loads with
+// OrtSessionConfig::tuning_file pick them up. Thread settings have no effect on an env with
+// global thread pools.
+class OrtAutoTuner
+{
+private:
+    OrtTuningConfig config;
+
+    bool Measure(const char *modelPath, const OrtSessionConfig &sessionConfig, std::vector<double> &p99LatencyUs, std::vector<double> &throughput) const;
+    double Score(const std::vector<double> &p99LatencyUs, const std::vector<double> &throughput, const std::vector<double> &baseP99LatencyUs, const std::vector<double> &baseThroughput) const;
+
+public:
+    OrtAutoTuner(const OrtTuningConfig &config = OrtTuningConfig());
+    OrtTuningResult Tune(const char *modelPath) const;
+    // Appends the result; a later entry for the same model and machine overrides earlier ones.
+    static bool SaveTunedConfig(const char *tuningFile, const char *modelPath, const OrtTuningResult &result);
+    // Copies the tuned fields of the newest matching entry into config. Returns false, leaving
+    // config untouched, when the file has no entry for this model and machine.
+    static bool ApplyTunedConfig(const char *tuningFile, const char *modelPath, const char *ortVersion, OrtSessionConfig &config);
+    static std::string MachineDescription(const char *ortVersion);
+};
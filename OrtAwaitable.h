@@ -0,0 +1,73 @@
+#pragma once
+// C++20 coroutine front end for OrtAsyncInference. The project itself builds as C++17, so
+// this header is empty unless the including target compiles with coroutine support.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+#include "OrtAsyncInference.h"
+
+// Decides where a coroutine continues once its run completes, e.g. by posting the handle to
+// an I/O loop. Empty resumes it directly on the thread that completed the run.
+typedef std::function<void(std::coroutine_handle<>)> OrtResumeExecutor;
+
+// Result of OrtCoroutineModel::Infer. Suspending submits the batch; no thread blocks while
+// the run is in flight, so the number of pending requests is not tied to a thread count.
+class OrtInferAwaitable
+{
+private:
+    OrtAsyncInference &async_inference;
+    const float *input_data;
+    size_t batch_size;
+    const OrtResumeExecutor &executor;
+    OrtBatchResult result;
+    bool ok;
+
+public:
+    OrtInferAwaitable(OrtAsyncInference &asyncInference, const float *inputData, size_t batchSize, const OrtResumeExecutor &executor)
+        : async_inference(asyncInference), input_data(inputData), batch_size(batchSize), executor(executor), ok(false) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    // Submit copies the input, so the caller's buffer only has to live until the co_await.
+    // The completion may resume the coroutine before Submit returns; nothing here touches
+    // the awaitable after Submit.
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        async_inference.Submit(input_data, batch_size, [this, handle](bool run_ok, const OrtBatchResult &batch)
+                               {
+            ok = run_ok;
+            result = batch;
+            if (executor)
+                executor(handle);
+            else
+                handle.resume(); });
+    }
+
+    OrtBatchResult await_resume()
+    {
+        if (!ok)
+            throw std::runtime_error("onnxruntime run failed");
+        return std::move(result);
+    }
+};
+
+// Lets coroutine request handlers write `OrtBatchResult out = co_await model.Infer(row, 1);`.
+class OrtCoroutineModel
+{
+private:
+    OrtAsyncInference &async_inference;
+    OrtResumeExecutor executor;
+
+public:
+    OrtCoroutineModel(OrtAsyncInference &asyncInference, OrtResumeExecutor executor = OrtResumeExecutor())
+        : async_inference(asyncInference), executor(std::move(executor)) {}
+
+    OrtInferAwaitable Infer(const float *inputData, size_t batchSize = 1)
+    {
+        return OrtInferAwaitable(async_inference, inputData, batchSize, executor);
+    }
+};
+#endif
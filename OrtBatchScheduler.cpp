@@ -0,0 +1,131 @@
+#include "OrtBatchScheduler.h"
+#include <string.h>
+#include <stdexcept>
+
+OrtBatchScheduler::OrtBatchScheduler(OrtInference &inference, const OrtBatchSchedulerConfig &config)
+    : inference(inference), config(config)
+{
+    if (this->config.max_batch_size == 0)
+        this->config.max_batch_size = 1;
+    stopping = false;
+    stats.batch_size_histogram.assign(this->config.max_batch_size + 1, 0);
+    worker = std::thread(&OrtBatchScheduler::WorkerLoop, this);
+}
+
+OrtBatchScheduler::~OrtBatchScheduler()
+{
+    Stop();
+}
+
+std::future<std::vector<float>> OrtBatchScheduler::Submit(const float *inputData, size_t inputSize)
+{
+    Request request;
+    std::future<std::vector<float>> result = request.result.get_future();
+    // Rows are packed back to back, so one of another length would shift every row after it.
+    size_t row_element_count = inference.InputRowElementCount();
+    if (row_element_count == 0 || inputSize != row_element_count * sizeof(float))
+    {
+        request.result.set_exception(std::make_exception_ptr(std::invalid_argument("Input size does not match the model's row size")));
+        return result;
+    }
+    request.input.assign(inputData, inputData + row_element_count);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping)
+        {
+            request.result.set_exception(std::make_exception_ptr(std::runtime_error("OrtBatchScheduler is stopped")));
+            return result;
+        }
+        request.enqueue_time = std::chrono::steady_clock::now();
+        queue.push_back(std::move(request));
+    }
+    queue_cv.notify_one();
+    return result;
+}
+
+OrtBatchSchedulerStats OrtBatchScheduler::GetStats()
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return stats;
+}
+
+// Drains the requests already queued, then joins the worker.
+void OrtBatchScheduler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+void OrtBatchScheduler::WorkerLoop()
+{
+    std::vector<Request> batch;
+    batch.reserve(config.max_batch_size);
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this]
+                          { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return;
+
+            // Hold the batch open until it is full or the oldest row has waited max_wait_us.
+            std::chrono::steady_clock::time_point deadline = queue.front().enqueue_time + std::chrono::microseconds(config.max_wait_us);
+            queue_cv.wait_until(lock, deadline, [this]
+                                { return stopping || queue.size() >= config.max_batch_size; });
+
+            while (!queue.empty() && batch.size() < config.max_batch_size)
+            {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+
+        RunBatch(batch);
+        batch.clear();
+    }
+}
+
+void OrtBatchScheduler::RunBatch(std::vector<Request> &batch)
+{
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < batch.size(); i++)
+        inference.RecordStage(OrtStageQueueWait, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(batch[i].enqueue_time.time_since_epoch()).count());
+    // Submit only queues rows of the model's row size, so they pack back to back.
+    std::vector<float> packed_input;
+    packed_input.reserve(batch.size() * inference.InputRowElementCount());
+    for (size_t i = 0; i < batch.size(); i++)
+        packed_input.insert(packed_input.end(), batch[i].input.begin(), batch[i].input.end());
+
+    std::vector<float> output;
+    size_t stride = inference.RunBatchInference(packed_input.data(), batch.size(), output);
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        // RunBatchInference has printed why the output could not be read.
+        if (stride == 0)
+        {
+            batch[i].result.set_exception(std::make_exception_ptr(std::runtime_error("output cannot be read as float")));
+            continue;
+        }
+        const float *row = output.data() + i * stride;
+        batch[i].result.set_value(std::vector<float>(row, row + stride));
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats.batch_size_histogram[batch.size()]++;
+    stats.batches++;
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        double wait_us = std::chrono::duration<double, std::micro>(start_time - batch[i].enqueue_time).count();
+        stats.requests++;
+        stats.total_queue_wait_us += wait_us;
+        if (wait_us > stats.max_queue_wait_us)
+            stats.max_queue_wait_us = wait_us;
+    }
+}
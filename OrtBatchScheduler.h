@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "OrtInference.h"
+
+struct OrtBatchSchedulerConfig
+{
+    size_t max_batch_size = 32;
+    int64_t max_wait_us = 500;
+};
+
+struct OrtBatchSchedulerStats
+{
+    // batch_size_histogram[n] counts the Run calls that packed n rows.
+    std::vector<uint64_t> batch_size_histogram;
+    uint64_t requests = 0;
+    uint64_t batches = 0;
+    double total_queue_wait_us = 0;
+    double max_queue_wait_us = 0;
+};
+
+// Collects single-row requests from any number of threads and feeds them to
+// OrtInference::RunBatchInference in batches of up to max_batch_size rows, waiting at
+// most max_wait_us after the first queued row. Each caller gets its row's outputs back
+// through the returned future, or a std::runtime_error when the output has no float form.
+// inputSize is in bytes and must be one row of the model's input; the future of any other
+// size holds a std::invalid_argument.
+class OrtBatchScheduler
+{
+private:
+    struct Request
+    {
+        std::vector<float> input;
+        std::promise<std::vector<float>> result;
+        std::chrono::steady_clock::time_point enqueue_time;
+    };
+
+    OrtInference &inference;
+    OrtBatchSchedulerConfig config;
+    std::deque<Request> queue;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    bool stopping;
+    std::thread worker;
+    std::mutex stats_mutex;
+    OrtBatchSchedulerStats stats;
+
+    void WorkerLoop();
+    void RunBatch(std::vector<Request> &batch);
+
+public:
+    OrtBatchScheduler(OrtInference &inference, const OrtBatchSchedulerConfig &config);
+    ~OrtBatchScheduler();
+    std::future<std::vector<float>> Submit(const float *inputData, size_t inputSize);
+    OrtBatchSchedulerStats GetStats();
+    void Stop();
+};
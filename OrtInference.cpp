@@ -1,64 +1,57 @@
 #include "OrtInference.h"
+#include "OrtAutoTuner.h"
+#include <string.h>
+#include <sys/stat.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include "onnxruntime_run_options_config_keys.h"
+#include "onnxruntime_session_options_config_keys.h"
 
 #ifdef _WIN32
-#define LoadDynamicLibrary(path) LoadLibraryA(path)
-#define GetFunctionFromLibrary(lib_ptr, func_name) GetProcAddress(lib_ptr, func_name)
-#define FreeDynamicLibrary(lib_ptr) FreeLibrary(lib_ptr)
-char DefaultLibraryPath[] = "./onnxruntime.dll";
-#elif __linux__
-#define LoadDynamicLibrary(path) dlopen(path, RTLD_NOW)
-#define GetFunctionFromLibrary(lib_ptr, func_name) dlsym(lib_ptr, func_name)
-#define FreeDynamicLibrary(lib_ptr) dlclose(lib_ptr)
-char DefaultLibraryPath[] = "./libonnxruntime.so.1.15.1";
-#elif __APPLE__
-#define LoadDynamicLibrary(path) dlopen(path, RTLD_NOW)
-#define GetFunctionFromLibrary(lib_ptr, func_name) dlsym(lib_ptr, func_name)
-#define FreeDynamicLibrary(lib_ptr) dlclose(lib_ptr)
-char DefaultLibraryPath[] = "./libonnxruntime.1.15.1.dylib";
-#else
-#define LoadDynamicLibrary(path) (nullptr)
-#define GetFunctionFromLibrary(lib_ptr, func_name) (nullptr)
-#define FreeDynamicLibrary(lib_ptr) ()
+#include <direct.h>
 #endif
 
-// A global pointer to the OrtApi.
-const OrtApi *ort_api = NULL;
+#ifdef _WIN32
+#define MakeDirectory(path) _mkdir(path)
+#else
+#define MakeDirectory(path) mkdir(path, 0755)
+#endif
 
-typedef const OrtApiBase *(*GetOrtApiBaseFunction)(void);
-#define CheckORTError(val) (InternalORTErrorCheck((val), #val, __FILE__, __LINE__))
-static void InternalORTErrorCheck(OrtStatus *status, const char *text,
-                                  const char *file, int line)
+#ifdef _WIN32
+static std::wstring ToOrtPath(const char *path)
 {
-    if (!status)
-        return;
-    printf("Got onnxruntime error %s, (%s at line %d in %s)\n",
-           ort_api->GetErrorMessage(status), text, line, file);
-    ort_api->ReleaseStatus(status);
-    exit(1);
+    size_t str_len = strlen(path) + 1;
+    std::wstring cast_string(str_len, L'\0');
+    std::mbstowcs(&cast_string[0], path, str_len);
+    return cast_string;
+}
+#else
+static std::string ToOrtPath(const char *path)
+{
+    return std::string(path);
 }
+#endif
 
 OrtInference::OrtInference()
 {
-    ort_library_ptr = nullptr;
-    api_base = nullptr;
+    runtime = nullptr;
     ort_env = nullptr;
     options = nullptr;
     session = nullptr;
     allocator = nullptr;
     memory_info = nullptr;
-    input_tensor = nullptr;
-    output_tensor = nullptr;
-    typeinfo = nullptr;
-    tensor_info = nullptr;
-    type = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
     num_dims = 0;
     input_shape = nullptr;
-    input_name = nullptr;
-    output_name = nullptr;
     output_values = nullptr;
     output_element_size = 0;
-    type_info = nullptr;
-    output_info = nullptr;
+    output_index = 0;
+    default_context = nullptr;
+    arena_shrink_batch_size = 0;
+    shrink_run_options = nullptr;
+    buffer_allocator = nullptr;
+    stage_metrics = nullptr;
+    model_mapping = nullptr;
 }
 
 OrtInference::~OrtInference()
@@ -66,142 +59,1020 @@ OrtInference::~OrtInference()
     ReleaseONNXRuntime();
 }
 
+// The library and the env are shared by every OrtInference in the process through OrtRuntime,
+// so only the first model actually loads the library and creates the env.
 void OrtInference::LoadONNXRuntimeLibrary()
 {
-    ort_library_ptr = LoadDynamicLibrary(DefaultLibraryPath);
+    if (!runtime)
+        runtime = OrtRuntime::Acquire();
+}
+
+void OrtInference::InitializeONNXEnvironment(const OrtEnvConfig &config)
+{
+    if (runtime)
+        ort_env = runtime->InitializeEnvironment(config);
+}
+
+// A model that cannot be loaded exits like every other ORT error here; the error itself has
+// already been printed by TryCreateSessionAndLoadModel.
+void OrtInference::CreateSessionAndLoadModel(const char *modelPath, const OrtSessionConfig &config)
+{
+    if (!TryCreateSessionAndLoadModel(modelPath, config))
+        exit(1);
+}
 
-    if (ort_library_ptr)
+bool OrtInference::TryCreateSessionAndLoadModel(const char *modelPath, const OrtSessionConfig &config)
+{
+    if (!config.tuning_file.empty())
     {
-        GetOrtApiBaseFunction get_api_base_fn = reinterpret_cast<GetOrtApiBaseFunction>(GetFunctionFromLibrary(ort_library_ptr, "OrtGetApiBase"));
+        OrtSessionConfig tuned_config = config;
+        tuned_config.tuning_file.clear();
+        if (OrtAutoTuner::ApplyTunedConfig(config.tuning_file.c_str(), modelPath, runtime->VersionString(), tuned_config))
+            printf("Using tuned session options from %s\n", config.tuning_file.c_str());
+        return TryCreateSessionAndLoadModel(modelPath, tuned_config);
+    }
 
-        if (get_api_base_fn)
+    CheckORTError(ort_api->CreateSessionOptions(&options));
+    // Sessions on a global thread pool env must not create their own pools, so the
+    // per-session thread counts do not apply there.
+    if (runtime->UsesGlobalThreadPools())
+        CheckORTError(ort_api->DisablePerSessionThreads(options));
+    else
+    {
+        if (config.intra_op_num_threads > 0)
+            CheckORTError(ort_api->SetIntraOpNumThreads(options, config.intra_op_num_threads));
+        if (config.inter_op_num_threads > 0)
+            CheckORTError(ort_api->SetInterOpNumThreads(options, config.inter_op_num_threads));
+        if (config.allow_spinning >= 0)
         {
-            ort_api = get_api_base_fn()->GetApi(ORT_API_VERSION);
+            const char *spinning = config.allow_spinning ? "1" : "0";
+            CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigAllowIntraOpSpinning, spinning));
+            CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigAllowInterOpSpinning, spinning));
         }
-        else
+    }
+    if (config.execution_mode >= 0)
+        CheckORTError(ort_api->SetSessionExecutionMode(options, (ExecutionMode)config.execution_mode));
+    if (config.memory_pattern == 0)
+        CheckORTError(ort_api->DisableMemPattern(options));
+    else if (config.memory_pattern > 0)
+        CheckORTError(ort_api->EnableMemPattern(options));
+    if (config.use_env_allocators)
+    {
+        runtime->EnsureEnvAllocator();
+        CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigUseEnvAllocators, "1"));
+        buffer_allocator = runtime->TensorAllocator();
+    }
+    if (config.arena_shrink_batch_size > 0)
+    {
+        arena_shrink_batch_size = config.arena_shrink_batch_size;
+        CheckORTError(ort_api->CreateRunOptions(&shrink_run_options));
+        CheckORTError(ort_api->AddRunConfigEntry(shrink_run_options, kOrtRunOptionsConfigEnableMemoryArenaShrinkage, "cpu:0"));
+    }
+    if (config.stage_metrics)
+        stage_metrics = new OrtStageMetrics();
+    if (!config.profile_file_prefix.empty())
+        CheckORTError(ort_api->EnableProfiling(options, ToOrtPath(config.profile_file_prefix.c_str()).c_str()));
+    if (config.graph_optimization_level >= 0)
+        CheckORTError(ort_api->SetSessionGraphOptimizationLevel(options, (GraphOptimizationLevel)config.graph_optimization_level));
+
+    std::string cache_path;
+    std::string cache_temp_path;
+    if (!config.optimized_model_cache_dir.empty())
+    {
+        cache_path = OptimizedModelCachePath(modelPath, config);
+        struct stat cache_stat;
+        if (!cache_path.empty() && stat(cache_path.c_str(), &cache_stat) == 0)
         {
-            printf("Failed to find Get API base function.");
+            // The cached model is already optimized at the requested level.
+            printf("Using optimized model %s\n", cache_path.c_str());
+            modelPath = cache_path.c_str();
+            CheckORTError(ort_api->SetSessionGraphOptimizationLevel(options, ORT_DISABLE_ALL));
+        }
+        else if (!cache_path.empty())
+        {
+            // Written under a temporary name and renamed once complete, so a concurrent or
+            // interrupted load never picks up a partial file.
+            cache_temp_path = cache_path + ".tmp" + std::to_string((unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count());
+            CheckORTError(ort_api->SetOptimizedModelFilePath(options, ToOrtPath(cache_temp_path.c_str()).c_str()));
+            if (config.cache_ort_format)
+                CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigSaveModelFormat, "ORT"));
         }
     }
-    else
+
+    // ORT only shares prepacked weights of initializers added with AddInitializer, so the
+    // initializers are shared along with the container.
+    OrtPrepackedWeightsContainer *prepacked_weights = nullptr;
+    size_t path_length = strlen(modelPath);
+    if (config.share_prepacked_weights && !(path_length > 4 && strcmp(modelPath + path_length - 4, ".ort") == 0))
     {
-        printf("Failed to load the onnxruntime library.");
+        shared_weights = runtime->SharedModelWeights(modelPath);
+        if (shared_weights)
+        {
+            shared_weights->AddToSessionOptions(options);
+            prepacked_weights = runtime->PrepackedWeightsContainer();
+        }
+    }
+    OrtStatus *status = config.memory_map_model ? CreateSessionFromMappedModel(modelPath, prepacked_weights) : CreateSessionFromPath(modelPath, prepacked_weights);
+    if (status)
+    {
+        printf("Failed to load %s: %s\n", modelPath, ort_api->GetErrorMessage(status));
+        ort_api->ReleaseStatus(status);
+        if (!cache_temp_path.empty())
+            remove(cache_temp_path.c_str());
+        return false;
+    }
+    printf("Loaded OK.\n");
+
+    if (!cache_temp_path.empty())
+    {
+        if (rename(cache_temp_path.c_str(), cache_path.c_str()) == 0)
+            printf("Saved optimized model %s\n", cache_path.c_str());
+        else
+            remove(cache_temp_path.c_str());
     }
+    return true;
 }
 
-void OrtInference::InitializeONNXEnvironment()
+// <cache dir>/<model file name>.<key>.onnx|.ort, where the key covers everything that changes
+// the optimized graph. A changed model, ORT upgrade or different level maps to a new file.
+// Returns an empty string when the model cannot be read or the directory cannot be created.
+std::string OrtInference::OptimizedModelCachePath(const char *modelPath, const OrtSessionConfig &config) const
 {
-    CheckORTError(ort_api->CreateEnv(ORT_LOGGING_LEVEL_FATAL, "Example", &ort_env));
+    OrtMappedFile model_file;
+    if (!model_file.Open(modelPath))
+        return std::string();
+    uint64_t key = HashBytes(model_file.Data(), model_file.Size());
+    std::string settings = std::string(runtime->VersionString()) + "|" + std::to_string(config.graph_optimization_level) + "|" + (config.cache_ort_format ? "ORT" : "ONNX");
+    key = HashBytes(settings.data(), settings.size(), key);
+
+    const std::string &cache_dir = config.optimized_model_cache_dir;
+    struct stat dir_stat;
+    if (stat(cache_dir.c_str(), &dir_stat) != 0 && MakeDirectory(cache_dir.c_str()) != 0)
+    {
+        printf("Failed to create cache directory %s\n", cache_dir.c_str());
+        return std::string();
+    }
+
+    const char *file_name = modelPath;
+    for (const char *c = modelPath; *c; c++)
+    {
+        if (*c == '/' || *c == '\\')
+            file_name = c + 1;
+    }
+    char key_text[17];
+    snprintf(key_text, sizeof(key_text), "%016llx", (unsigned long long)key);
+    std::string cache_path = cache_dir;
+    if (cache_path.back() != '/' && cache_path.back() != '\\')
+        cache_path += '/';
+    return cache_path + file_name + "." + key_text + (config.cache_ort_format ? ".ort" : ".onnx");
 }
 
-void OrtInference::CreateSessionAndLoadModel(const char *modelPath)
+OrtStatus *OrtInference::CreateSessionFromPath(const char *modelPath, OrtPrepackedWeightsContainer *prepackedWeights)
 {
-    CheckORTError(ort_api->CreateSessionOptions(&options));
+    if (prepackedWeights)
+        return ort_api->CreateSessionWithPrepackedWeightsContainer(ort_env, ToOrtPath(modelPath).c_str(), options, prepackedWeights, &session);
+    return ort_api->CreateSession(ort_env, ToOrtPath(modelPath).c_str(), options, &session);
+}
 
-#ifdef _WIN32
-    size_t str_len = strlen(modelPath) + 1;
-    std::wstring cast_string(str_len, L'\0');
-    std::mbstowcs(&cast_string[0], modelPath, str_len);
-#else
-    std::string cast_string = modelPath;
-#endif
+// Maps the model file and creates the session from the mapped bytes, so the file is not
+// read into a separate heap buffer. ORT-format models are used in place: the session keeps
+// pointing into the mapping (including initializers), which then lives as long as the session.
+// A file that cannot be mapped is loaded by path instead.
+OrtStatus *OrtInference::CreateSessionFromMappedModel(const char *modelPath, OrtPrepackedWeightsContainer *prepackedWeights)
+{
+    model_mapping = new OrtMappedFile();
+    if (!model_mapping->Open(modelPath))
+    {
+        printf("Failed to map %s, loading it by path.\n", modelPath);
+        delete model_mapping;
+        model_mapping = nullptr;
+        return CreateSessionFromPath(modelPath, prepackedWeights);
+    }
 
-    CheckORTError(ort_api->CreateSession(ort_env, (const ORTCHAR_T *)cast_string.c_str(), options, &session));
-    printf("Loaded OK.\n");
+    size_t path_length = strlen(modelPath);
+    bool ort_format = path_length > 4 && strcmp(modelPath + path_length - 4, ".ort") == 0;
+    if (ort_format)
+    {
+        CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigLoadModelFormat, "ORT"));
+        CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigUseORTModelBytesDirectly, "1"));
+        CheckORTError(ort_api->AddSessionConfigEntry(options, kOrtSessionOptionsConfigUseORTModelBytesForInitializers, "1"));
+    }
+
+    OrtStatus *status;
+    if (prepackedWeights)
+        status = ort_api->CreateSessionFromArrayWithPrepackedWeightsContainer(ort_env, model_mapping->Data(), model_mapping->Size(), options, prepackedWeights, &session);
+    else
+        status = ort_api->CreateSessionFromArray(ort_env, model_mapping->Data(), model_mapping->Size(), options, &session);
+    if (status || !ort_format)
+    {
+        // An ONNX model is parsed into ORT's own graph, so only a loaded .ort model keeps
+        // the mapping.
+        delete model_mapping;
+        model_mapping = nullptr;
+    }
+    return status;
 }
 
+static void ReadSignature(OrtTypeInfo *type_info, OrtTensorSignature &signature)
+{
+    CheckORTError(ort_api->GetOnnxTypeFromTypeInfo(type_info, &signature.onnx_type));
+    signature.element_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    signature.shape.clear();
+    if (signature.onnx_type != ONNX_TYPE_TENSOR)
+        return;
+
+    const OrtTensorTypeAndShapeInfo *tensor_info;
+    size_t dims_count;
+    CheckORTError(ort_api->CastTypeInfoToTensorInfo(type_info, &tensor_info));
+    CheckORTError(ort_api->GetTensorElementType(tensor_info, &signature.element_type));
+    CheckORTError(ort_api->GetDimensionsCount(tensor_info, &dims_count));
+    signature.shape.resize(dims_count);
+    CheckORTError(ort_api->GetDimensions(tensor_info, signature.shape.data(), dims_count));
+}
+
+// Reads the names, types and shapes of every input and output once into the signature
+// tables. The single-input path below keeps using input 0 and output 1 (or 0).
 void OrtInference::GetInputOutputInfo()
 {
     CheckORTError(ort_api->GetAllocatorWithDefaultOptions(&allocator));
     CheckORTError(ort_api->SessionGetInputCount(session, &input_modes_num));
     CheckORTError(ort_api->SessionGetOutputCount(session, &output_modes_num));
 
-    CheckORTError(ort_api->SessionGetInputName(session, 0, allocator, &input_name));
-    input_names[0] = input_name;
+    input_signatures.resize(input_modes_num);
+    for (size_t i = 0; i < input_modes_num; i++)
+    {
+        char *name;
+        OrtTypeInfo *type_info;
+        CheckORTError(ort_api->SessionGetInputName(session, i, allocator, &name));
+        input_signatures[i].name = name;
+        allocator->Free(allocator, name);
+        CheckORTError(ort_api->SessionGetInputTypeInfo(session, i, &type_info));
+        ReadSignature(type_info, input_signatures[i]);
+        ort_api->ReleaseTypeInfo(type_info);
+    }
+
+    output_signatures.resize(output_modes_num);
+    for (size_t i = 0; i < output_modes_num; i++)
+    {
+        char *name;
+        OrtTypeInfo *type_info;
+        CheckORTError(ort_api->SessionGetOutputName(session, i, allocator, &name));
+        output_signatures[i].name = name;
+        allocator->Free(allocator, name);
+        CheckORTError(ort_api->SessionGetOutputTypeInfo(session, i, &type_info));
+        ReadSignature(type_info, output_signatures[i]);
+        ort_api->ReleaseTypeInfo(type_info);
+    }
+
+    // The tables are not resized after this point, so the name pointers stay valid.
+    input_name_table.resize(input_modes_num);
+    for (size_t i = 0; i < input_modes_num; i++)
+        input_name_table[i] = input_signatures[i].name.c_str();
+    output_name_table.resize(output_modes_num);
+    for (size_t i = 0; i < output_modes_num; i++)
+        output_name_table[i] = output_signatures[i].name.c_str();
+
+    input_names[0] = input_name_table[0];
     printf("Input %d : name=%s\n", 0, input_names[0]);
 
-    CheckORTError(ort_api->SessionGetOutputName(session, (output_modes_num == 2) ? 1 : 0, allocator, &output_name));
+    output_index = (output_modes_num == 2) ? 1 : 0;
     printf("output_modes_num: %zu\n", output_modes_num);
-    output_names[0] = output_name;
+    output_names[0] = output_name_table[output_index];
     printf("Output %d : name=%s\n", 0, output_names[0]);
 
-    CheckORTError(ort_api->SessionGetInputTypeInfo(session, 0, &typeinfo));
-    CheckORTError(ort_api->CastTypeInfoToTensorInfo(typeinfo, &tensor_info));
-    CheckORTError(ort_api->GetTensorElementType(tensor_info, &type));
-    CheckORTError(ort_api->GetDimensionsCount(tensor_info, &num_dims));
+    num_dims = input_signatures[0].shape.size();
     printf("Input %d : num_dims=%zu\n", 0, num_dims);
 
     input_shape = (int64_t *)malloc(num_dims * sizeof(int64_t));
-    CheckORTError(ort_api->GetDimensions(tensor_info, input_shape, num_dims));
+    memcpy(input_shape, input_signatures[0].shape.data(), num_dims * sizeof(int64_t));
     input_shape[0] = 1;
     for (size_t j = 0; j < num_dims; j++)
         printf("Input %d : dim %zu=%lld\n", 0, j, input_shape[j]);
+
+    CheckORTError(ort_api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &memory_info));
+    default_context = CreateContext();
 }
 
-void OrtInference::PrepareInputData(float *inputData, size_t inputSize)
+OrtInferenceContext::OrtInferenceContext(const OrtInference &inference)
+    : inference(inference)
 {
-    CheckORTError(ort_api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &memory_info));
-    CheckORTError(ort_api->CreateTensorWithDataAsOrtValue(memory_info, inputData, inputSize, input_shape, num_dims, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_tensor));
+    input_tensor = nullptr;
+    type_info = nullptr;
+    output_info = nullptr;
+    map_output = nullptr;
+    map_values = nullptr;
+    input_buffer = nullptr;
+    input_buffer_size = 0;
+    steady_state = false;
+    output_preallocated = false;
+    output_values = nullptr;
+    output_element_size = 0;
 }
 
-void OrtInference::RunInference()
+OrtInferenceContext::~OrtInferenceContext()
 {
-    CheckORTError(ort_api->Run(session, NULL, input_names, (const OrtValue *const *)&input_tensor, 1, output_names, 1, &output_tensor));
+    ort_api->ReleaseTypeInfo(type_info);
+    ort_api->ReleaseTensorTypeAndShapeInfo(output_info);
+    ort_api->ReleaseValue(map_values);
+    ort_api->ReleaseValue(map_output);
+    ort_api->ReleaseValue(input_tensor);
+    FreeInputBuffer();
 }
 
-void OrtInference::ProcessOutput()
+void OrtInferenceContext::FreeInputBuffer()
 {
+    if (input_buffer && inference.buffer_allocator)
+        inference.buffer_allocator->Free(inference.buffer_allocator, input_buffer);
+    else
+        free(input_buffer);
+    input_buffer = nullptr;
+}
+
+// Creates the input and output OrtValues once for the fixed shape found by GetInputOutputInfo.
+// Afterwards PrepareInputData only copies into the bound input buffer and RunInference writes
+// into the same output tensor, so the per-call path does no heap allocation in the wrapper.
+// Only float tensor outputs with a fixed shape are preallocated. Label tensors and ZipMap
+// (sequence of map) outputs, i.e. most classifiers, are still created by ORT on every Run and
+// read by ProcessOutput (without printing), about 40 allocations per call for the bundled
+// classifiers. ORT itself also allocates inside every Run (execution frame and kernel
+// scratch, about 30 blocks for the bundled models, the same through IoBinding).
+// ort_alloc_test checks what the wrapper guarantees.
+void OrtInferenceContext::EnableSteadyState()
+{
+    size_t input_element_count = 1;
+    for (size_t j = 0; j < inference.num_dims; j++)
+    {
+        if (inference.input_shape[j] <= 0)
+        {
+            printf("Steady state needs a fixed input shape, dim %zu=%lld.\n", j, (long long)inference.input_shape[j]);
+            return;
+        }
+        input_element_count *= inference.input_shape[j];
+    }
+
+    ort_api->ReleaseValue(input_tensor);
+    input_tensor = nullptr;
+    FreeInputBuffer();
+    steady_state = false;
+    input_buffer_size = input_element_count * sizeof(float);
+    if (inference.buffer_allocator)
+    {
+        input_buffer = (float *)inference.buffer_allocator->Alloc(inference.buffer_allocator, input_buffer_size);
+        if (input_buffer)
+            memset(input_buffer, 0, input_buffer_size);
+    }
+    else
+        input_buffer = (float *)calloc(input_element_count, sizeof(float));
+    if (!input_buffer)
+    {
+        printf("Failed to allocate the steady state input buffer of %zu bytes.\n", input_buffer_size);
+        input_buffer_size = 0;
+        return;
+    }
+    CheckORTError(ort_api->CreateTensorWithDataAsOrtValue(inference.memory_info, input_buffer, input_buffer_size, inference.input_shape, inference.num_dims, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_tensor));
+
+    // Only float tensor outputs with a known shape can be preallocated. Label and
+    // sequence-of-map (ZipMap) outputs are still created by ORT on every Run.
+    OrtTypeInfo *output_type_info;
     ONNXType output_type;
-    CheckORTError(ort_api->GetTypeInfo(output_tensor, &type_info));
+    CheckORTError(ort_api->SessionGetOutputTypeInfo(inference.session, inference.output_index, &output_type_info));
+    CheckORTError(ort_api->GetOnnxTypeFromTypeInfo(output_type_info, &output_type));
+    output_preallocated = false;
+    if (output_type == ONNX_TYPE_TENSOR)
+    {
+        const OrtTensorTypeAndShapeInfo *output_tensor_info;
+        ONNXTensorElementDataType output_elem_type;
+        size_t output_num_dims;
+        CheckORTError(ort_api->CastTypeInfoToTensorInfo(output_type_info, &output_tensor_info));
+        CheckORTError(ort_api->GetTensorElementType(output_tensor_info, &output_elem_type));
+        CheckORTError(ort_api->GetDimensionsCount(output_tensor_info, &output_num_dims));
+        int64_t *output_shape = (int64_t *)malloc(output_num_dims * sizeof(int64_t));
+        CheckORTError(ort_api->GetDimensions(output_tensor_info, output_shape, output_num_dims));
+
+        output_preallocated = (output_elem_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+        if (output_num_dims > 0 && output_shape[0] < 0)
+            output_shape[0] = inference.input_shape[0];
+        for (size_t j = 0; j < output_num_dims; j++)
+        {
+            if (output_shape[j] < 0)
+                output_preallocated = false;
+        }
+
+        if (output_preallocated)
+        {
+            OrtValue *preallocated_output;
+            OrtAllocator *output_allocator = inference.buffer_allocator ? inference.buffer_allocator : inference.allocator;
+            CheckORTError(ort_api->CreateTensorAsOrtValue(output_allocator, output_shape, output_num_dims, output_elem_type, &preallocated_output));
+            output_tensor = MakeOrtValuePtr(preallocated_output);
+            CheckORTError(ort_api->GetTensorMutableData(output_tensor.get(), (void **)(&output_values)));
+            output_element_size = 1;
+            for (size_t j = 0; j < output_num_dims; j++)
+                output_element_size *= output_shape[j];
+        }
+        free(output_shape);
+    }
+    ort_api->ReleaseTypeInfo(output_type_info);
+
+    steady_state = true;
+    printf("Steady state: input %zu bytes, output %s.\n", input_buffer_size, output_preallocated ? "preallocated" : "allocated per run");
+}
+
+bool OrtInferenceContext::OutputPreallocated() const
+{
+    return output_preallocated;
+}
+
+void OrtInferenceContext::PrepareInputData(float *inputData, size_t inputSize)
+{
+    uint64_t start = inference.StageClock();
+    if (steady_state)
+    {
+        if (inputSize > input_buffer_size)
+        {
+            printf("Input of %zu bytes exceeds the steady state buffer of %zu bytes.\n", inputSize, input_buffer_size);
+            return;
+        }
+        memcpy(input_buffer, inputData, inputSize);
+    }
+    else
+    {
+        ort_api->ReleaseValue(input_tensor);
+        CheckORTError(ort_api->CreateTensorWithDataAsOrtValue(inference.memory_info, inputData, inputSize, inference.input_shape, inference.num_dims, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_tensor));
+    }
+    inference.RecordStage(OrtStagePrepare, start);
+}
+
+void OrtInferenceContext::RunInference()
+{
+    uint64_t start = inference.StageClock();
+    if (!output_preallocated)
+        output_tensor.reset();
+    OrtValue *output = output_tensor.get();
+    CheckORTError(ort_api->Run(inference.session, NULL, inference.input_names, (const OrtValue *const *)&input_tensor, 1, inference.output_names, 1, &output));
+    if (!output_preallocated)
+        output_tensor = MakeOrtValuePtr(output);
+    inference.RecordStage(OrtStageRun, start);
+}
+
+void OrtInferenceContext::ProcessOutput()
+{
+    uint64_t start = inference.StageClock();
+    // output_values already points into the preallocated output tensor.
+    if (output_preallocated)
+    {
+        inference.RecordStage(OrtStageProcess, start);
+        return;
+    }
+
+    ort_api->ReleaseTypeInfo(type_info);
+    ort_api->ReleaseTensorTypeAndShapeInfo(output_info);
+    ort_api->ReleaseValue(map_values);
+    ort_api->ReleaseValue(map_output);
+    type_info = NULL;
+    output_info = NULL;
+    map_values = NULL;
+    map_output = NULL;
+
+    // The steady-state loop is the hot path, so it reads the output without printing it.
+    bool verbose = !steady_state;
+    ONNXType output_type;
+    CheckORTError(ort_api->GetTypeInfo(output_tensor.get(), &type_info));
     CheckORTError(ort_api->GetOnnxTypeFromTypeInfo(type_info, &output_type));
-    printf("output_type: %d\n", output_type);
+    if (verbose)
+        printf("output_type: %d\n", output_type);
 
     if (output_type == ONNX_TYPE_TENSOR)
     {
         ONNXTensorElementDataType tensor_type;
-        CheckORTError(ort_api->GetTensorTypeAndShape(output_tensor, &output_info));
+        CheckORTError(ort_api->GetTensorTypeAndShape(output_tensor.get(), &output_info));
         CheckORTError(ort_api->GetTensorElementType(output_info, &tensor_type));
-        printf("tensor_type: %d\n", tensor_type);
+        if (verbose)
+            printf("tensor_type: %d\n", tensor_type);
 
         if (tensor_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64)
         {
-            int *ints;
+            int64_t *labels;
             CheckORTError(ort_api->GetTensorShapeElementCount(output_info, &output_element_size));
-            CheckORTError(ort_api->GetTensorMutableData(output_tensor, (void **)(&ints)));
-            printf("out size: %zu\n", output_element_size);
-            printf("label: %d\n", ints[0]);
+            CheckORTError(ort_api->GetTensorMutableData(output_tensor.get(), (void **)(&labels)));
+            if (verbose)
+            {
+                printf("out size: %zu\n", output_element_size);
+                printf("label: %lld\n", (long long)labels[0]);
+            }
         }
         else
         {
             CheckORTError(ort_api->GetTensorShapeElementCount(output_info, &output_element_size));
-            CheckORTError(ort_api->GetTensorMutableData(output_tensor, (void **)(&output_values)));
+            CheckORTError(ort_api->GetTensorMutableData(output_tensor.get(), (void **)(&output_values)));
+            if (verbose)
+                printf("out size: %zu\n", output_element_size);
+        }
+    }
+    else if (output_type == ONNX_TYPE_SEQUENCE)
+    {
+        CheckORTError(ort_api->GetValue(output_tensor.get(), static_cast<int>(0), inference.allocator, &map_output));
+        CheckORTError(ort_api->GetValue(map_output, 1, inference.allocator, &map_values));
+        CheckORTError(ort_api->GetTensorTypeAndShape(map_values, &output_info));
+        CheckORTError(ort_api->GetTensorShapeElementCount(output_info, &output_element_size));
+        CheckORTError(ort_api->GetTensorMutableData(map_values, (void **)(&output_values)));
+        if (verbose)
             printf("out size: %zu\n", output_element_size);
+    }
+    inference.RecordStage(OrtStageProcess, start);
+}
+
+// Typed view of the last output. It shares the OrtValue, so it stays valid after the next
+// RunInference; with a preallocated output the next run overwrites the same buffer.
+OrtOutput OrtInferenceContext::GetOutput() const
+{
+    return OrtOutput(output_tensor);
+}
+
+OrtInferenceContext *OrtInference::CreateContext() const
+{
+    return new OrtInferenceContext(*this);
+}
+
+void OrtInference::EnableSteadyState()
+{
+    default_context->EnableSteadyState();
+    output_values = default_context->output_values;
+    output_element_size = default_context->output_element_size;
+}
+
+void OrtInference::PrepareInputData(float *inputData, size_t inputSize)
+{
+    default_context->PrepareInputData(inputData, inputSize);
+}
+
+void OrtInference::RunInference()
+{
+    default_context->RunInference();
+}
+
+void OrtInference::ProcessOutput()
+{
+    default_context->ProcessOutput();
+    output_values = default_context->output_values;
+    output_element_size = default_context->output_element_size;
+}
+
+// Run options for a batch of batchSize rows: the arena-shrinking ones from batches of
+// arena_shrink_batch_size rows on, otherwise none.
+const OrtRunOptions *OrtInference::BatchRunOptions(size_t batchSize) const
+{
+    return arena_shrink_batch_size > 0 && batchSize >= arena_shrink_batch_size ? shrink_run_options : NULL;
+}
+
+// Runs batchSize rows packed back to back in inputData with a single Run call by filling
+// dimension 0 of the input shape with batchSize. Row i of the result is stored at
+// outputData[i * stride], where stride is the returned number of output values per row.
+// Numeric tensor outputs (converted to float) and the sequence-of-map outputs of the
+// classifiers are handled. Returns 0 with outputData empty for an empty batch or an output
+// that cannot be read as floats.
+size_t OrtInference::RunBatchInference(const float *inputData, size_t batchSize, std::vector<float> &outputData) const
+{
+    if (batchSize == 0)
+    {
+        printf("RunBatchInference needs at least one row.\n");
+        outputData.clear();
+        return 0;
+    }
+
+    uint64_t start = StageClock();
+    OrtValue *batch_input = CreateBatchInput(inputData, batchSize);
+    OrtValue *batch_output = NULL;
+    start = RecordStage(OrtStagePrepare, start);
+
+    CheckORTError(ort_api->Run(session, BatchRunOptions(batchSize), input_names, (const OrtValue *const *)&batch_input, 1, output_names, 1, &batch_output));
+    start = RecordStage(OrtStageRun, start);
+
+    size_t stride = ReadBatchOutput(batch_output, batchSize, outputData);
+    ort_api->ReleaseValue(batch_output);
+    ort_api->ReleaseValue(batch_input);
+    RecordStage(OrtStageProcess, start);
+    return stride;
+}
+
+size_t OrtInference::InputRowElementCount() const
+{
+    size_t row_element_count = 1;
+    for (size_t j = 1; j < num_dims; j++)
+    {
+        if (input_shape[j] <= 0)
+            return 0;
+        row_element_count *= input_shape[j];
+    }
+    return row_element_count;
+}
+
+// Wraps batchSize rows of inputData (not copied) in an input tensor with dimension 0 set to
+// batchSize. The caller releases the value.
+OrtValue *OrtInference::CreateBatchInput(const float *inputData, size_t batchSize) const
+{
+    std::vector<int64_t> batch_shape(input_shape, input_shape + num_dims);
+    size_t row_element_count = InputRowElementCount();
+    batch_shape[0] = batchSize;
+
+    OrtValue *batch_input = NULL;
+    CheckORTError(ort_api->CreateTensorWithDataAsOrtValue(memory_info, (void *)inputData, batchSize * row_element_count * sizeof(float), batch_shape.data(), num_dims, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &batch_input));
+    return batch_input;
+}
+
+template <typename T>
+static void ConvertToFloat(const void *values, size_t count, float *outputData)
+{
+    const T *typed_values = (const T *)values;
+    for (size_t i = 0; i < count; i++)
+        outputData[i] = (float)typed_values[i];
+}
+
+// Copies the selected output of a batched run into outputData and returns the stride per row,
+// or 0 when the output is empty or of a type that has no float conversion here.
+size_t OrtInference::ReadBatchOutput(OrtValue *batch_output, size_t batchSize, std::vector<float> &outputData) const
+{
+    size_t stride = 0;
+    outputData.clear();
+    if (batchSize == 0)
+        return 0;
+    ONNXType output_type;
+    OrtTypeInfo *batch_type_info;
+    CheckORTError(ort_api->GetTypeInfo(batch_output, &batch_type_info));
+    CheckORTError(ort_api->GetOnnxTypeFromTypeInfo(batch_type_info, &output_type));
+    ort_api->ReleaseTypeInfo(batch_type_info);
+
+    if (output_type == ONNX_TYPE_TENSOR)
+    {
+        OrtTensorTypeAndShapeInfo *batch_info;
+        ONNXTensorElementDataType tensor_type;
+        size_t element_count;
+        CheckORTError(ort_api->GetTensorTypeAndShape(batch_output, &batch_info));
+        CheckORTError(ort_api->GetTensorElementType(batch_info, &tensor_type));
+        CheckORTError(ort_api->GetTensorShapeElementCount(batch_info, &element_count));
+        ort_api->ReleaseTensorTypeAndShapeInfo(batch_info);
+
+        void *values;
+        CheckORTError(ort_api->GetTensorMutableData(batch_output, &values));
+        outputData.resize(element_count);
+        switch (tensor_type)
+        {
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+            memcpy(outputData.data(), values, element_count * sizeof(float));
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+            ConvertToFloat<double>(values, element_count, outputData.data());
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+            ConvertToFloat<int64_t>(values, element_count, outputData.data());
+            break;
+        case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+            ConvertToFloat<int32_t>(values, element_count, outputData.data());
+            break;
+        default:
+            printf("Output element type %d cannot be read as float.\n", (int)tensor_type);
+            outputData.clear();
+            return 0;
         }
+        stride = element_count / batchSize;
     }
     else if (output_type == ONNX_TYPE_SEQUENCE)
     {
-        OrtValue *map_out;
-        CheckORTError(ort_api->GetValue(output_tensor, static_cast<int>(0), allocator, &map_out));
+        size_t map_count;
+        CheckORTError(ort_api->GetValueCount(batch_output, &map_count));
+        for (size_t i = 0; i < map_count; i++)
+        {
+            OrtValue *row_map;
+            OrtValue *row_values;
+            OrtTensorTypeAndShapeInfo *row_info;
+            size_t element_count;
+            float *values;
+            CheckORTError(ort_api->GetValue(batch_output, static_cast<int>(i), allocator, &row_map));
+            CheckORTError(ort_api->GetValue(row_map, 1, allocator, &row_values));
+            CheckORTError(ort_api->GetTensorTypeAndShape(row_values, &row_info));
+            CheckORTError(ort_api->GetTensorShapeElementCount(row_info, &element_count));
+            CheckORTError(ort_api->GetTensorMutableData(row_values, (void **)(&values)));
+            if (i == 0)
+            {
+                stride = element_count;
+                outputData.resize(map_count * stride);
+            }
+            memcpy(outputData.data() + i * stride, values, stride * sizeof(float));
+            ort_api->ReleaseTensorTypeAndShapeInfo(row_info);
+            ort_api->ReleaseValue(row_values);
+            ort_api->ReleaseValue(row_map);
+        }
+    }
 
-        OrtValue *values_ort;
-        CheckORTError(ort_api->GetValue(map_out, 1, allocator, &values_ort));
-        CheckORTError(ort_api->GetTensorTypeAndShape(values_ort, &output_info));
-        CheckORTError(ort_api->GetTensorShapeElementCount(output_info, &output_element_size));
-        CheckORTError(ort_api->GetTensorMutableData(values_ort, (void **)(&output_values)));
-        printf("out size: %zu\n", output_element_size);
+    return stride;
+}
+
+const std::vector<OrtTensorSignature> &OrtInference::GetInputSignatures() const
+{
+    return input_signatures;
+}
+
+const std::vector<OrtTensorSignature> &OrtInference::GetOutputSignatures() const
+{
+    return output_signatures;
+}
+
+// Returns the index of the input/output with the given name, or -1. Meant for setting up
+// run plans; the run path itself only works with indices.
+int OrtInference::FindInput(const char *name) const
+{
+    for (size_t i = 0; i < input_signatures.size(); i++)
+    {
+        if (input_signatures[i].name == name)
+            return (int)i;
     }
+    return -1;
 }
 
+int OrtInference::FindOutput(const char *name) const
+{
+    for (size_t i = 0; i < output_signatures.size(); i++)
+    {
+        if (output_signatures[i].name == name)
+            return (int)i;
+    }
+    return -1;
+}
+
+// Resolves the selected input/output indices to name pointers once, so Run(plan, ...) passes
+// them straight to ORT.
+OrtRunPlan OrtInference::CreateRunPlan(const std::vector<size_t> &inputIndices, const std::vector<size_t> &outputIndices) const
+{
+    OrtRunPlan plan;
+    for (size_t i = 0; i < inputIndices.size(); i++)
+        plan.input_names.push_back(input_name_table[inputIndices[i]]);
+    for (size_t i = 0; i < outputIndices.size(); i++)
+        plan.output_names.push_back(output_name_table[outputIndices[i]]);
+    return plan;
+}
+
+// inputs holds one value per input of the plan, outputs one slot per output. Empty output
+// slots (NULL) are allocated by ORT and owned by the caller afterwards.
+void OrtInference::Run(const OrtRunPlan &plan, const OrtValue *const *inputs, OrtValue **outputs) const
+{
+    uint64_t start = StageClock();
+    RunUntimed(plan, inputs, outputs);
+    RecordStage(OrtStageRun, start);
+}
+
+// Warmup and MeasureRuns go through here, so synthetic runs stay out of the stage metrics.
+void OrtInference::RunUntimed(const OrtRunPlan &plan, const OrtValue *const *inputs, OrtValue **outputs) const
+{
+    CheckORTError(ort_api->Run(session, NULL, plan.input_names.data(), inputs, plan.input_names.size(), plan.output_names.data(), plan.output_names.size(), outputs));
+}
+
+// Same as above, but hands each output back as an OrtOutput that owns it.
+std::vector<OrtOutput> OrtInference::Run(const OrtRunPlan &plan, const OrtValue *const *inputs) const
+{
+    std::vector<OrtValue *> values(plan.output_names.size(), NULL);
+    Run(plan, inputs, values.data());
+    std::vector<OrtOutput> outputs;
+    outputs.reserve(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+        outputs.push_back(OrtOutput(values[i]));
+    return outputs;
+}
+
+// Runs every input and output of the model on synthesized inputs, so arena growth, weight
+// prepacking and lazy kernel setup happen here instead of in the first real requests.
+// Batch sizes the model cannot take (a fixed first dimension) are skipped. Models with
+// non-tensor or string inputs are not warmed up and return an empty report.
+OrtWarmupReport OrtInference::Warmup(const OrtWarmupConfig &config) const
+{
+    OrtWarmupReport report;
+    for (size_t i = 0; i < input_signatures.size(); i++)
+    {
+        const OrtTensorSignature &signature = input_signatures[i];
+        if (signature.onnx_type != ONNX_TYPE_TENSOR || signature.element_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING)
+        {
+            printf("Warmup skipped, input %s is not a numeric tensor.\n", signature.name.c_str());
+            return report;
+        }
+    }
+
+    OrtRunPlan plan = CreateFullRunPlan();
+
+    size_t window = config.window > 0 ? config.window : 1;
+    bool first_run = true;
+    for (size_t b = 0; b < config.batch_sizes.size(); b++)
+    {
+        size_t batch_size = config.batch_sizes[b];
+        if (!AcceptsSyntheticInputs(batch_size))
+            continue;
+
+        std::vector<OrtValue *> inputs(input_signatures.size());
+        for (size_t i = 0; i < inputs.size(); i++)
+            inputs[i] = CreateWarmupInput(input_signatures[i], batch_size);
+        std::vector<OrtValue *> outputs(output_signatures.size(), NULL);
+
+        std::vector<double> latencies;
+        double previous_median = -1;
+        double median = 0;
+        size_t runs = 0;
+        while (runs < config.max_runs || first_run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            RunUntimed(plan, inputs.data(), outputs.data());
+            double latency = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            for (size_t i = 0; i < outputs.size(); i++)
+            {
+                ort_api->ReleaseValue(outputs[i]);
+                outputs[i] = NULL;
+            }
+            runs++;
+            if (first_run)
+            {
+                report.cold_latency_us = latency;
+                first_run = false;
+                continue;
+            }
+
+            latencies.push_back(latency);
+            if (latencies.size() < window)
+                continue;
+            std::nth_element(latencies.begin(), latencies.begin() + window / 2, latencies.end());
+            median = latencies[window / 2];
+            latencies.clear();
+            if (previous_median > 0 && fabs(median - previous_median) <= config.tolerance * previous_median)
+                break;
+            previous_median = median;
+        }
+
+        for (size_t i = 0; i < inputs.size(); i++)
+            ort_api->ReleaseValue(inputs[i]);
+        report.batch_sizes.push_back(batch_size);
+        report.warm_latency_us.push_back(median);
+        report.runs.push_back(runs);
+    }
+
+    printf("Warmup: cold %.1f us", report.cold_latency_us);
+    for (size_t i = 0; i < report.batch_sizes.size(); i++)
+        printf(", batch %zu warm %.1f us (%zu runs)", report.batch_sizes[i], report.warm_latency_us[i], report.runs[i]);
+    printf("\n");
+    return report;
+}
+
+// Runs the whole model runs times on inputs synthesized as in Warmup and returns the latency
+// of every run in microseconds. Empty if such inputs cannot be built for batchSize.
+std::vector<double> OrtInference::MeasureRuns(size_t batchSize, size_t runs) const
+{
+    std::vector<double> latencies;
+    if (!AcceptsSyntheticInputs(batchSize))
+        return latencies;
+
+    OrtRunPlan plan = CreateFullRunPlan();
+    std::vector<OrtValue *> inputs(input_signatures.size());
+    for (size_t i = 0; i < inputs.size(); i++)
+        inputs[i] = CreateWarmupInput(input_signatures[i], batchSize);
+    std::vector<OrtValue *> outputs(output_signatures.size(), NULL);
+    latencies.reserve(runs);
+    for (size_t r = 0; r < runs; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        RunUntimed(plan, inputs.data(), outputs.data());
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            ort_api->ReleaseValue(outputs[i]);
+            outputs[i] = NULL;
+        }
+    }
+    for (size_t i = 0; i < inputs.size(); i++)
+        ort_api->ReleaseValue(inputs[i]);
+    return latencies;
+}
+
+std::string OrtInference::EndProfiling()
+{
+    char *profile_path = nullptr;
+    CheckORTError(ort_api->SessionEndProfiling(session, allocator, &profile_path));
+    std::string path = profile_path ? profile_path : "";
+    if (profile_path)
+        allocator->Free(allocator, profile_path);
+    return path;
+}
+
+const OrtStageMetrics *OrtInference::StageMetrics() const
+{
+    return stage_metrics;
+}
+
+uint64_t OrtInference::StageClock() const
+{
+    return stage_metrics ? OrtStageMetrics::Now() : 0;
+}
+
+uint64_t OrtInference::RecordStage(OrtStage stage, uint64_t startNs) const
+{
+    if (!stage_metrics)
+        return 0;
+    uint64_t now = OrtStageMetrics::Now();
+    stage_metrics->Record(stage, now > startNs ? now - startNs : 0);
+    return now;
+}
+
+// Inputs can be synthesized when all of them are numeric tensors whose first dimension is
+// dynamic or equal to batchSize.
+bool OrtInference::AcceptsSyntheticInputs(size_t batchSize) const
+{
+    if (batchSize == 0)
+        return false;
+    for (size_t i = 0; i < input_signatures.size(); i++)
+    {
+        const OrtTensorSignature &signature = input_signatures[i];
+        if (signature.onnx_type != ONNX_TYPE_TENSOR || signature.element_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING)
+            return false;
+        if (!signature.shape.empty() && signature.shape[0] > 0 && (size_t)signature.shape[0] != batchSize)
+            return false;
+    }
+    return true;
+}
+
+OrtRunPlan OrtInference::CreateFullRunPlan() const
+{
+    std::vector<size_t> input_indices(input_signatures.size());
+    std::vector<size_t> output_indices(output_signatures.size());
+    for (size_t i = 0; i < input_indices.size(); i++)
+        input_indices[i] = i;
+    for (size_t i = 0; i < output_indices.size(); i++)
+        output_indices[i] = i;
+    return CreateRunPlan(input_indices, output_indices);
+}
+
+// An ORT-owned tensor shaped like the signature, with dynamic dimensions set to batchSize
+// for the first and 1 for the rest. Floating point inputs are 0.5, everything else 0 so
+// that index-like inputs stay in range.
+OrtValue *OrtInference::CreateWarmupInput(const OrtTensorSignature &signature, size_t batchSize) const
+{
+    std::vector<int64_t> shape = signature.shape;
+    for (size_t i = 0; i < shape.size(); i++)
+    {
+        if (shape[i] < 0)
+            shape[i] = i == 0 ? (int64_t)batchSize : 1;
+    }
+
+    OrtValue *value = NULL;
+    CheckORTError(ort_api->CreateTensorAsOrtValue(allocator, shape.data(), shape.size(), signature.element_type, &value));
+    OrtTensorTypeAndShapeInfo *info;
+    size_t element_count;
+    CheckORTError(ort_api->GetTensorTypeAndShape(value, &info));
+    CheckORTError(ort_api->GetTensorShapeElementCount(info, &element_count));
+    ort_api->ReleaseTensorTypeAndShapeInfo(info);
+
+    void *data;
+    CheckORTError(ort_api->GetTensorMutableData(value, &data));
+    switch (signature.element_type)
+    {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+        std::fill((float *)data, (float *)data + element_count, 0.5f);
+        break;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+        std::fill((double *)data, (double *)data + element_count, 0.5);
+        break;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+        std::fill((uint16_t *)data, (uint16_t *)data + element_count, (uint16_t)0x3800);
+        break;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+        std::fill((uint16_t *)data, (uint16_t *)data + element_count, (uint16_t)0x3f00);
+        break;
+    default:
+        memset(data, 0, element_count * OrtElementSize(signature.element_type));
+        break;
+    }
+    return value;
+}
+
+// Releases everything this model created, then its reference to the shared runtime.
+// Safe to call more than once; the destructor calls it as well.
 void OrtInference::ReleaseONNXRuntime()
 {
-    ort_api->ReleaseTypeInfo(type_info);
-    ort_api->ReleaseTensorTypeAndShapeInfo(output_info);
-    ort_api->ReleaseValue(output_tensor);
-    ort_api->ReleaseValue(input_tensor);
+    if (!runtime)
+        return;
+
+    delete default_context;
     ort_api->ReleaseMemoryInfo(memory_info);
+    free(input_shape);
+    default_context = NULL;
+    memory_info = NULL;
+    input_shape = NULL;
     ort_api->ReleaseSession(session);
     ort_api->ReleaseSessionOptions(options);
-    ort_api->ReleaseEnv(ort_env);
+    delete model_mapping;
+    shared_weights.reset();
+    if (shrink_run_options)
+        ort_api->ReleaseRunOptions(shrink_run_options);
+    shrink_run_options = NULL;
+    delete stage_metrics;
+    stage_metrics = NULL;
+    session = NULL;
+    options = NULL;
+    model_mapping = NULL;
     ort_env = NULL;
+    OrtRuntime::Release();
+    runtime = NULL;
     printf("Cleanup complete.\n");
 }
\ No newline at end of file
@@ -1,33 +1,156 @@
+#pragma once
 #include <stdio.h>
 #include <stdlib.h>
+#include <memory>
 #include <string>
+#include <vector>
 
-#if defined(_WIN32) && defined(__GNUC__)
-#undef _WIN32
-#include "onnxruntime_c_api.h"
-#define _WIN32
-#else
-#include "onnxruntime_c_api.h"
-#endif
+#include "OrtMappedFile.h"
+#include "OrtModelWeights.h"
+#include "OrtOutputView.h"
+#include "OrtRuntime.h"
+#include "OrtStageMetrics.h"
 
-#ifdef _WIN32
-#include <Windows.h>
-#define LIB_PTR HMODULE
-#elif __linux__
-#include <dlfcn.h>
-#define LIB_PTR void *
-#elif __APPLE__
-#include <dlfcn.h>
-#define LIB_PTR void *
-#else
-#define LIB_PTR void *
-#endif
+class OrtInference;
 
+// Session options applied by CreateSessionAndLoadModel. Zero keeps the ORT default.
+struct OrtSessionConfig
+{
+    int intra_op_num_threads = 0;
+    // Only used by ORT_PARALLEL execution.
+    int inter_op_num_threads = 0;
+    // ExecutionMode for the session; -1 keeps the ORT default (ORT_SEQUENTIAL).
+    int execution_mode = -1;
+    // -1 keeps the ORT default, 0 disables and 1 enables spinning of idle session pool threads.
+    int allow_spinning = -1;
+    // -1 keeps the ORT default, 0 disables and 1 enables memory pattern planning.
+    int memory_pattern = -1;
+    // Load through a memory mapping and CreateSessionFromArray instead of by path. For .ort
+    // files the mapped bytes are used directly by the session. A file that cannot be mapped
+    // is loaded by path.
+    bool memory_map_model = false;
+    // GraphOptimizationLevel for the session; -1 keeps the ORT default (ORT_ENABLE_ALL).
+    int graph_optimization_level = -1;
+    // Directory for optimized models. The first load writes the optimized model there, keyed by
+    // the model's content hash, the ORT version, the optimization level and the format; later
+    // loads with the same key use that file and skip graph optimization. Empty disables it.
+    std::string optimized_model_cache_dir;
+    // Store the cached model in ORT format instead of ONNX.
+    bool cache_ort_format = false;
+    // Share the model's initializers and their prepacked forms with every other session of
+    // the same file loaded with this flag, through OrtRuntime. Further sessions of the model
+    // then add almost no memory. Has no effect on .ort models.
+    bool share_prepacked_weights = false;
+    // Allocate from the CPU arena shared through the env instead of a session-owned one, so
+    // memory freed by one model is reused by the others rather than every session keeping its
+    // own peak. Sessions running concurrently then contend on that one arena.
+    bool use_env_allocators = false;
+    // Batched runs with at least this many rows (RunBatchInference, which OrtBatchScheduler and
+    // OrtSessionPool go through, and OrtAsyncInference) ask ORT to shrink the CPU arena back
+    // after the run, so one unusually large batch does not pin its peak for the life of
+    // the process; 0 never shrinks. Freed chunks only leave the process if the C library
+    // returns them, e.g. with glibc a fixed M_MMAP_THRESHOLD (MALLOC_MMAP_THRESHOLD_).
+    size_t arena_shrink_batch_size = 0;
+    // File written by OrtAutoTuner. When it holds settings for this model on this machine,
+    // they replace the thread, execution mode, optimization level, spinning and memory
+    // pattern fields above. Empty disables the lookup.
+    std::string tuning_file;
+    // Enable ORT profiling; the trace is written to <prefix>_<timestamp>.json once
+    // EndProfiling() is called, see OrtProfileSummary. Empty disables it.
+    std::string profile_file_prefix;
+    // Time the prepare, Run and process stages of every call, and the queue wait of the
+    // schedulers feeding this model, into OrtStageMetrics histograms. Costs two clock reads
+    // and a few relaxed stores per stage, so it is off unless asked for.
+    bool stage_metrics = false;
+};
+
+// Name, type and shape of one model input or output, read once at load. element_type and
+// shape are only set for tensors; dynamic dimensions are -1.
+struct OrtTensorSignature
+{
+    std::string name;
+    ONNXType onnx_type;
+    ONNXTensorElementDataType element_type;
+    std::vector<int64_t> shape;
+};
+
+// A subset of inputs and outputs resolved to their names ahead of time by CreateRunPlan.
+struct OrtRunPlan
+{
+    std::vector<const char *> input_names;
+    std::vector<const char *> output_names;
+};
+
+// How Warmup exercises a loaded model. Each batch size is run until the median latency of
+// one window of runs is within tolerance of the window before it, or max_runs is reached.
+struct OrtWarmupConfig
+{
+    std::vector<size_t> batch_sizes = {1, 8, 32};
+    size_t window = 5;
+    double tolerance = 0.05;
+    size_t max_runs = 200;
+};
+
+// Latencies seen by Warmup, in microseconds. cold_latency_us is the first run after load;
+// warm_latency_us[i] is the settled median for batch_sizes[i] after runs[i] runs.
+struct OrtWarmupReport
+{
+    double cold_latency_us = 0;
+    std::vector<size_t> batch_sizes;
+    std::vector<double> warm_latency_us;
+    std::vector<size_t> runs;
+};
+
+// Per-call state for running the model of an OrtInference. A context is used by one thread
+// at a time, while any number of contexts can run against the same OrtInference at once.
+class OrtInferenceContext
+{
+private:
+    const OrtInference &inference;
+    OrtValue *input_tensor;
+    OrtValuePtr output_tensor;
+    OrtTypeInfo *type_info;
+    OrtTensorTypeAndShapeInfo *output_info;
+    OrtValue *map_output;
+    OrtValue *map_values;
+    float *input_buffer;
+    size_t input_buffer_size;
+    bool steady_state;
+    bool output_preallocated;
+
+    void FreeInputBuffer();
+
+public:
+    float *output_values;
+    size_t output_element_size;
+    OrtInferenceContext(const OrtInference &inference);
+    OrtInferenceContext(const OrtInferenceContext &) = delete;
+    OrtInferenceContext &operator=(const OrtInferenceContext &) = delete;
+    ~OrtInferenceContext();
+    // Binds reusable input/output tensors. Allocation-free per call only for float tensor
+    // outputs of fixed shape; label and ZipMap outputs (most classifiers) are still created by
+    // ORT on every run. See OrtInference.cpp.
+    void EnableSteadyState();
+    // True once EnableSteadyState has bound a preallocated output tensor, so ProcessOutput
+    // does no work. Map and label outputs are still created by ORT on every run.
+    bool OutputPreallocated() const;
+    void PrepareInputData(float *inputData, size_t inputSize);
+    void RunInference();
+    void ProcessOutput();
+    OrtOutput GetOutput() const;
+};
+
+// Owns the loaded session. After GetInputOutputInfo it is only read, so contexts from
+// CreateContext() and RunBatchInference can be used from many threads concurrently.
+// The single-call methods below go through a default context and are not thread-safe.
 class OrtInference
 {
+    friend class OrtInferenceContext;
+    friend class OrtInferenceBinding;
+    friend class OrtAsyncInference;
+
 private:
-    LIB_PTR ort_library_ptr;
-    const OrtApiBase *api_base;
+    OrtRuntime *runtime;
     OrtEnv *ort_env;
     OrtSessionOptions *options;
     OrtSession *session;
@@ -35,19 +158,33 @@ private:
     size_t input_modes_num;
     size_t output_modes_num;
     OrtMemoryInfo *memory_info;
-    OrtValue *input_tensor;
-    OrtValue *output_tensor;
-    OrtTypeInfo *typeinfo;
-    const OrtTensorTypeAndShapeInfo *tensor_info;
-    ONNXTensorElementDataType type;
+    std::vector<OrtTensorSignature> input_signatures;
+    std::vector<OrtTensorSignature> output_signatures;
+    std::vector<const char *> input_name_table;
+    std::vector<const char *> output_name_table;
     size_t num_dims;
     int64_t *input_shape;
-    char *input_name;
-    char *input_names[1];
-    char *output_name;
-    char *output_names[1];
-    OrtTypeInfo *type_info;
-    OrtTensorTypeAndShapeInfo *output_info;
+    const char *input_names[1];
+    const char *output_names[1];
+    size_t output_index;
+    OrtInferenceContext *default_context;
+    OrtMappedFile *model_mapping;
+    std::shared_ptr<const OrtModelWeights> shared_weights;
+    size_t arena_shrink_batch_size;
+    // Allocator for the wrapper's own tensor buffers; nullptr uses the C heap and ORT's default.
+    OrtAllocator *buffer_allocator;
+    OrtRunOptions *shrink_run_options;
+    OrtStageMetrics *stage_metrics;
+
+    OrtStatus *CreateSessionFromPath(const char *modelPath, OrtPrepackedWeightsContainer *prepackedWeights);
+    OrtStatus *CreateSessionFromMappedModel(const char *modelPath, OrtPrepackedWeightsContainer *prepackedWeights);
+    OrtValue *CreateBatchInput(const float *inputData, size_t batchSize) const;
+    OrtValue *CreateWarmupInput(const OrtTensorSignature &signature, size_t batchSize) const;
+    bool AcceptsSyntheticInputs(size_t batchSize) const;
+    const OrtRunOptions *BatchRunOptions(size_t batchSize) const;
+    void RunUntimed(const OrtRunPlan &plan, const OrtValue *const *inputs, OrtValue **outputs) const;
+    OrtRunPlan CreateFullRunPlan() const;
+    size_t ReadBatchOutput(OrtValue *batch_output, size_t batchSize, std::vector<float> &outputData) const;
 
 public:
     float *output_values;
@@ -55,11 +192,43 @@ public:
     OrtInference();
     ~OrtInference();
     void LoadONNXRuntimeLibrary();
-    void InitializeONNXEnvironment();
-    void CreateSessionAndLoadModel(const char *modelPath);
+    void InitializeONNXEnvironment(const OrtEnvConfig &config = OrtEnvConfig());
+    void CreateSessionAndLoadModel(const char *modelPath, const OrtSessionConfig &config = OrtSessionConfig());
+    // Same as CreateSessionAndLoadModel, except that a model ORT rejects (e.g. a corrupt or
+    // truncated file) prints the error and returns false instead of exiting. The object can then
+    // only be released.
+    bool TryCreateSessionAndLoadModel(const char *modelPath, const OrtSessionConfig &config = OrtSessionConfig());
+    // File in config.optimized_model_cache_dir that CreateSessionAndLoadModel writes or reuses for
+    // the model; empty when the model cannot be read or the directory cannot be created. Needs
+    // LoadONNXRuntimeLibrary first, as the key covers the ORT version.
+    std::string OptimizedModelCachePath(const char *modelPath, const OrtSessionConfig &config) const;
     void GetInputOutputInfo();
+    OrtInferenceContext *CreateContext() const;
+    void EnableSteadyState();
     void PrepareInputData(float *inputData, size_t inputSize);
     void RunInference();
     void ProcessOutput();
+    size_t RunBatchInference(const float *inputData, size_t batchSize, std::vector<float> &outputData) const;
+    // Floats in one row of input 0 (its dimensions after the batch one); 0 when one of them is
+    // dynamic, as the row length is then not fixed.
+    size_t InputRowElementCount() const;
+    const std::vector<OrtTensorSignature> &GetInputSignatures() const;
+    const std::vector<OrtTensorSignature> &GetOutputSignatures() const;
+    int FindInput(const char *name) const;
+    int FindOutput(const char *name) const;
+    OrtRunPlan CreateRunPlan(const std::vector<size_t> &inputIndices, const std::vector<size_t> &outputIndices) const;
+    void Run(const OrtRunPlan &plan, const OrtValue *const *inputs, OrtValue **outputs) const;
+    std::vector<OrtOutput> Run(const OrtRunPlan &plan, const OrtValue *const *inputs) const;
+    OrtWarmupReport Warmup(const OrtWarmupConfig &config = OrtWarmupConfig()) const;
+    std::vector<double> MeasureRuns(size_t batchSize, size_t runs) const;
+    // Stops profiling and returns the path of the written trace, empty if profiling was off.
+    std::string EndProfiling();
+    // nullptr when the model was loaded without stage_metrics.
+    const OrtStageMetrics *StageMetrics() const;
+    // OrtStageMetrics::Now() when metrics are on, otherwise 0 without reading the clock.
+    uint64_t StageClock() const;
+    // Records the time since startNs (from StageClock) for the stage and returns the end time,
+    // so back-to-back stages can share one clock read. A no-op returning 0 without metrics.
+    uint64_t RecordStage(OrtStage stage, uint64_t startNs) const;
     void ReleaseONNXRuntime();
 };
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "OrtInferenceBinding.h"
+
+OrtInferenceBinding::OrtInferenceBinding(const OrtInference &inference)
+    : inference(inference)
+{
+    io_binding = nullptr;
+    CheckORTError(ort_api->CreateIoBinding(inference.session, &io_binding));
+}
+
+OrtInferenceBinding::~OrtInferenceBinding()
+{
+    ort_api->ReleaseIoBinding(io_binding);
+}
+
+OrtValue *OrtInferenceBinding::CreateBufferValue(void *buffer, size_t bufferSize, const std::vector<int64_t> &shape, ONNXTensorElementDataType elementType) const
+{
+    OrtValue *value;
+    CheckORTError(ort_api->CreateTensorWithDataAsOrtValue(inference.memory_info, buffer, bufferSize, shape.data(), shape.size(), elementType, &value));
+    return value;
+}
+
+void OrtInferenceBinding::BindInput(size_t inputIndex, void *buffer, size_t bufferSize, const std::vector<int64_t> &shape)
+{
+    // The binding keeps its own reference to the value, so ours is released right away.
+    OrtValue *value = CreateBufferValue(buffer, bufferSize, shape, inference.input_signatures[inputIndex].element_type);
+    CheckORTError(ort_api->BindInput(io_binding, inference.input_name_table[inputIndex], value));
+    ort_api->ReleaseValue(value);
+}
+
+bool OrtInferenceBinding::BindOutput(size_t outputIndex, void *buffer, size_t bufferSize, const std::vector<int64_t> &shape)
+{
+    const OrtTensorSignature &signature = inference.output_signatures[outputIndex];
+    size_t element_size = OrtElementSize(signature.element_type);
+    size_t element_count = 1;
+    bool fixed_shape = (signature.onnx_type == ONNX_TYPE_TENSOR && element_size > 0);
+    for (size_t j = 0; j < shape.size(); j++)
+    {
+        if (shape[j] < 0)
+            fixed_shape = false;
+        else
+            element_count *= shape[j];
+    }
+
+    if (!fixed_shape || element_count * element_size > bufferSize)
+    {
+        BindOutput(outputIndex);
+        return false;
+    }
+
+    OrtValue *value = CreateBufferValue(buffer, bufferSize, shape, signature.element_type);
+    CheckORTError(ort_api->BindOutput(io_binding, inference.output_name_table[outputIndex], value));
+    ort_api->ReleaseValue(value);
+    return true;
+}
+
+void OrtInferenceBinding::BindOutput(size_t outputIndex)
+{
+    CheckORTError(ort_api->BindOutputToDevice(io_binding, inference.output_name_table[outputIndex], inference.memory_info));
+}
+
+void OrtInferenceBinding::Run()
+{
+    uint64_t start = inference.StageClock();
+    CheckORTError(ort_api->RunWithBinding(inference.session, NULL, io_binding));
+    inference.RecordStage(OrtStageRun, start);
+}
+
+std::vector<OrtOutput> OrtInferenceBinding::GetOutputs() const
+{
+    OrtValue **values;
+    size_t count;
+    std::vector<OrtOutput> outputs;
+    CheckORTError(ort_api->GetBoundOutputValues(io_binding, inference.allocator, &values, &count));
+    outputs.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        outputs.push_back(OrtOutput(values[i]));
+    if (values)
+        inference.allocator->Free(inference.allocator, values);
+    return outputs;
+}
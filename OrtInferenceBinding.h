@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+
+#include "OrtInference.h"
+
+// Run path over an OrtIoBinding. Inputs and outputs are bound once to caller-owned buffers;
+// after that each Run() reads the input buffers and ORT writes the results straight into
+// the output buffers, with no output allocation or copy-out per call. Outputs whose shape
+// is not known up front (dynamic dims, sequence/map outputs) are bound to the CPU device
+// instead and ORT allocates them per run; read those through GetOutputs().
+class OrtInferenceBinding
+{
+private:
+    const OrtInference &inference;
+    OrtIoBinding *io_binding;
+
+    OrtValue *CreateBufferValue(void *buffer, size_t bufferSize, const std::vector<int64_t> &shape, ONNXTensorElementDataType elementType) const;
+
+public:
+    OrtInferenceBinding(const OrtInference &inference);
+    OrtInferenceBinding(const OrtInferenceBinding &) = delete;
+    OrtInferenceBinding &operator=(const OrtInferenceBinding &) = delete;
+    ~OrtInferenceBinding();
+    // The element type of the buffers comes from the input/output signature.
+    void BindInput(size_t inputIndex, void *buffer, size_t bufferSize, const std::vector<int64_t> &shape);
+    // Returns false when the output fell back to ORT allocation.
+    bool BindOutput(size_t outputIndex, void *buffer, size_t bufferSize, const std::vector<int64_t> &shape);
+    void BindOutput(size_t outputIndex);
+    void Run();
+    // All bound outputs in binding order, including the ones backed by caller buffers.
+    std::vector<OrtOutput> GetOutputs() const;
+};
@@ -0,0 +1,113 @@
+#include "OrtMappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+OrtMappedFile::OrtMappedFile()
+{
+#ifdef _WIN32
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#else
+    file_descriptor = -1;
+#endif
+    mapped_data = nullptr;
+    mapped_size = 0;
+}
+
+OrtMappedFile::~OrtMappedFile()
+{
+    Close();
+}
+
+bool OrtMappedFile::Open(const char *path)
+{
+    Close();
+#ifdef _WIN32
+    file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+    mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_handle == NULL)
+    {
+        Close();
+        return false;
+    }
+    mapped_data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    mapped_size = (size_t)file_size.QuadPart;
+#else
+    file_descriptor = open(path, O_RDONLY);
+    if (file_descriptor < 0)
+        return false;
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+    mapped_size = (size_t)file_stat.st_size;
+    mapped_data = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (mapped_data == MAP_FAILED)
+        mapped_data = nullptr;
+#endif
+    if (!mapped_data)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void OrtMappedFile::Close()
+{
+#ifdef _WIN32
+    if (mapped_data)
+        UnmapViewOfFile(mapped_data);
+    if (mapping_handle != NULL)
+        CloseHandle(mapping_handle);
+    if (file_handle != INVALID_HANDLE_VALUE)
+        CloseHandle(file_handle);
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = NULL;
+#else
+    if (mapped_data)
+        munmap(mapped_data, mapped_size);
+    if (file_descriptor >= 0)
+        close(file_descriptor);
+    file_descriptor = -1;
+#endif
+    mapped_data = nullptr;
+    mapped_size = 0;
+}
+
+const void *OrtMappedFile::Data() const
+{
+    return mapped_data;
+}
+
+size_t OrtMappedFile::Size() const
+{
+    return mapped_size;
+}
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OrtRuntime.h"
+
+// Read-only memory mapping of a whole file, used to hand model bytes to
+// CreateSessionFromArray without reading them into a heap buffer first.
+class OrtMappedFile
+{
+private:
+#ifdef _WIN32
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#else
+    int file_descriptor;
+#endif
+    void *mapped_data;
+    size_t mapped_size;
+
+public:
+    OrtMappedFile();
+    OrtMappedFile(const OrtMappedFile &) = delete;
+    OrtMappedFile &operator=(const OrtMappedFile &) = delete;
+    ~OrtMappedFile();
+    bool Open(const char *path);
+    void Close();
+    const void *Data() const;
+    size_t Size() const;
+};
+
+// FNV-1a over size bytes, continued from seed; used to key files derived from model contents.
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ULL);
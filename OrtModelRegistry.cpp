@@ -0,0 +1,299 @@
+#include "OrtModelRegistry.h"
+#include <sys/stat.h>
+#include <atomic>
+#include <thread>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Resident set size of the process, 0 where it cannot be read.
+static size_t ReadResidentBytes()
+{
+#ifdef __linux__
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm)
+        return 0;
+    unsigned long long total_pages = 0;
+    unsigned long long resident_pages = 0;
+    int fields = fscanf(statm, "%llu %llu", &total_pages, &resident_pages);
+    fclose(statm);
+    return fields == 2 ? (size_t)resident_pages * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+static size_t ReadFileSize(const std::string &path)
+{
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0)
+        return 0;
+    return (size_t)file_stat.st_size;
+}
+
+OrtModelRegistry::OrtModelRegistry(const OrtModelRegistryConfig &config)
+    : config(config)
+{
+    use_clock = 0;
+    memory_usage = 0;
+}
+
+void OrtModelRegistry::Register(const std::string &name, const std::string &version, const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[std::make_pair(name, version)];
+    entry.name = name;
+    entry.version = version;
+    entry.path = path;
+    latest_versions[name] = version;
+}
+
+std::shared_ptr<const OrtInference> OrtModelRegistry::Get(const std::string &name, const std::string &version)
+{
+    std::vector<std::shared_ptr<const OrtInference>> evicted;
+    std::unique_lock<std::mutex> lock(mutex);
+    Entry *entry = FindEntry(name, version);
+    if (!entry)
+        return std::shared_ptr<const OrtInference>();
+
+    while (true)
+    {
+        entry->last_used = ++use_clock;
+        if (entry->model)
+            return entry->model;
+        if (entry->loading)
+        {
+            // Another thread is loading this model; wait for it instead of loading it twice.
+            loaded_cv.wait(lock, [entry] { return !entry->loading; });
+            continue;
+        }
+
+        entry->loading = true;
+        std::string path = entry->path;
+        lock.unlock();
+        std::unique_lock<std::mutex> load_lock(load_mutex);
+        size_t resident_before = ReadResidentBytes();
+        std::shared_ptr<const OrtInference> model = LoadModel(path);
+        size_t resident_after = ReadResidentBytes();
+        load_lock.unlock();
+        lock.lock();
+        StoreModel(*entry, model, resident_after > resident_before ? resident_after - resident_before : 0);
+        EvictOverBudget(entry, evicted);
+        return model;
+    }
+}
+
+void OrtModelRegistry::Preload(const std::vector<std::pair<std::string, std::string>> &models)
+{
+    std::vector<std::shared_ptr<const OrtInference>> evicted;
+    std::vector<Entry *> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (models.empty())
+        {
+            for (std::map<std::pair<std::string, std::string>, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+                pending.push_back(&it->second);
+        }
+        else
+        {
+            for (size_t i = 0; i < models.size(); i++)
+            {
+                Entry *entry = FindEntry(models[i].first, models[i].second);
+                if (entry)
+                    pending.push_back(entry);
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            if (pending[i]->model || pending[i]->loading)
+                continue;
+            pending[i]->loading = true;
+            pending[i]->last_used = ++use_clock;
+            pending[kept++] = pending[i];
+        }
+        pending.resize(kept);
+    }
+    if (pending.empty())
+        return;
+
+    std::vector<std::string> paths(pending.size());
+    for (size_t i = 0; i < pending.size(); i++)
+        paths[i] = pending[i]->path;
+    std::vector<std::shared_ptr<const OrtInference>> loaded(pending.size());
+    size_t thread_count = config.preload_threads > 0 ? config.preload_threads : std::thread::hardware_concurrency();
+    if (thread_count == 0)
+        thread_count = 1;
+    if (thread_count > pending.size())
+        thread_count = pending.size();
+
+    std::unique_lock<std::mutex> load_lock(load_mutex);
+    size_t resident_before = ReadResidentBytes();
+    std::atomic<size_t> next_index(0);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < thread_count; t++)
+    {
+        workers.emplace_back([&] {
+            for (size_t i = next_index++; i < paths.size(); i = next_index++)
+                loaded[i] = LoadModel(paths[i]);
+        });
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    size_t resident_after = ReadResidentBytes();
+    load_lock.unlock();
+
+    // The loads ran concurrently, so their RSS growth is split by model file size.
+    size_t growth = resident_after > resident_before ? resident_after - resident_before : 0;
+    std::vector<size_t> file_sizes(paths.size());
+    size_t total_file_size = 0;
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        file_sizes[i] = ReadFileSize(paths[i]);
+        total_file_size += file_sizes[i];
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        size_t share = total_file_size > 0 ? (size_t)((double)growth * file_sizes[i] / total_file_size) : growth / pending.size();
+        StoreModel(*pending[i], loaded[i], share);
+    }
+    EvictOverBudget(nullptr, evicted);
+}
+
+// Drops the registry's reference; the session is released once its last holder is done.
+bool OrtModelRegistry::Evict(const std::string &name, const std::string &version)
+{
+    std::shared_ptr<const OrtInference> model;
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = FindEntry(name, version);
+    if (!entry || !entry->model)
+        return false;
+    model.swap(entry->model);
+    memory_usage -= entry->memory_bytes;
+    return true;
+}
+
+size_t OrtModelRegistry::MemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memory_usage;
+}
+
+std::vector<OrtModelInfo> OrtModelRegistry::List() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<OrtModelInfo> models;
+    for (std::map<std::pair<std::string, std::string>, Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        OrtModelInfo info;
+        info.name = it->second.name;
+        info.version = it->second.version;
+        info.path = it->second.path;
+        info.loaded = (bool)it->second.model;
+        info.memory_bytes = it->second.memory_bytes;
+        info.loads = it->second.loads;
+        models.push_back(info);
+    }
+    return models;
+}
+
+std::string OrtModelRegistry::PrometheusText() const
+{
+    std::vector<std::pair<std::string, std::shared_ptr<const OrtInference>>> models;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::map<std::pair<std::string, std::string>, Entry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            if (it->second.model && it->second.model->StageMetrics())
+            {
+                std::string labels = OrtStageMetrics::PrometheusLabel("model", it->second.name) + "," + OrtStageMetrics::PrometheusLabel("version", it->second.version);
+                models.push_back(std::make_pair(labels, it->second.model));
+            }
+        }
+    }
+
+    std::string out;
+    OrtStageMetrics::AppendPrometheusHeader(out);
+    for (size_t i = 0; i < models.size(); i++)
+        models[i].second->StageMetrics()->AppendPrometheusSamples(out, models[i].first);
+    return out;
+}
+
+OrtModelRegistry::Entry *OrtModelRegistry::FindEntry(const std::string &name, const std::string &version)
+{
+    std::string resolved_version = version;
+    if (resolved_version.empty())
+    {
+        std::map<std::string, std::string>::iterator latest = latest_versions.find(name);
+        if (latest == latest_versions.end())
+            return nullptr;
+        resolved_version = latest->second;
+    }
+    std::map<std::pair<std::string, std::string>, Entry>::iterator it = entries.find(std::make_pair(name, resolved_version));
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+std::shared_ptr<const OrtInference> OrtModelRegistry::LoadModel(const std::string &path) const
+{
+    OrtInference *inference = new OrtInference();
+    inference->LoadONNXRuntimeLibrary();
+    inference->InitializeONNXEnvironment();
+    if (!inference->TryCreateSessionAndLoadModel(path.c_str(), config.session_config))
+    {
+        delete inference;
+        return std::shared_ptr<const OrtInference>();
+    }
+    inference->GetInputOutputInfo();
+    if (config.warmup)
+        inference->Warmup();
+    return std::shared_ptr<const OrtInference>(inference);
+}
+
+// Called with the mutex held once a load finished. A failed load (empty model) leaves the
+// entry unloaded, so the next Get tries the file again.
+void OrtModelRegistry::StoreModel(Entry &entry, std::shared_ptr<const OrtInference> model, size_t memoryBytes)
+{
+    if (!model)
+    {
+        entry.loading = false;
+        loaded_cv.notify_all();
+        return;
+    }
+    size_t file_size = ReadFileSize(entry.path);
+    entry.memory_bytes = memoryBytes > file_size ? memoryBytes : file_size;
+    entry.model = model;
+    entry.loading = false;
+    entry.loads++;
+    memory_usage += entry.memory_bytes;
+    loaded_cv.notify_all();
+}
+
+// Called with the mutex held. The evicted sessions are handed back so the caller can release
+// them after unlocking instead of tearing sessions down while other lookups wait.
+void OrtModelRegistry::EvictOverBudget(const Entry *keep, std::vector<std::shared_ptr<const OrtInference>> &evicted)
+{
+    if (config.memory_budget_bytes == 0)
+        return;
+    while (memory_usage > config.memory_budget_bytes)
+    {
+        Entry *oldest = nullptr;
+        for (std::map<std::pair<std::string, std::string>, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            Entry &entry = it->second;
+            if (entry.model && &entry != keep && (!oldest || entry.last_used < oldest->last_used))
+                oldest = &entry;
+        }
+        if (!oldest)
+        {
+            printf("Model memory %zu bytes is over the budget of %zu bytes.\n", memory_usage, config.memory_budget_bytes);
+            return;
+        }
+        printf("Evicting model %s version %s.\n", oldest->name.c_str(), oldest->version.c_str());
+        evicted.push_back(oldest->model);
+        oldest->model.reset();
+        memory_usage -= oldest->memory_bytes;
+    }
+}
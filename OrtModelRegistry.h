@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OrtInference.h"
+
+struct OrtModelRegistryConfig
+{
+    // Loaded models are evicted least recently used first while their total memory is above
+    // the budget; 0 never evicts.
+    size_t memory_budget_bytes = 0;
+    OrtSessionConfig session_config;
+    bool warmup = false;
+    // Threads used by Preload; 0 uses one per hardware thread.
+    size_t preload_threads = 0;
+};
+
+struct OrtModelInfo
+{
+    std::string name;
+    std::string version;
+    std::string path;
+    bool loaded;
+    // Memory attributed to the session when it was loaded, see OrtModelRegistry.
+    size_t memory_bytes;
+    uint64_t loads;
+};
+
+// Registered models keyed by name and version, loaded on first use. Each load is charged the
+// growth of the process RSS while it ran, but at least the model file size (only the file
+// size where RSS cannot be read). On-demand loads therefore run one at a time; loads done
+// together by Preload share the total growth in proportion to their file sizes. Sessions handed out stay valid after eviction until their
+// holders drop them.
+class OrtModelRegistry
+{
+private:
+    struct Entry
+    {
+        std::string name;
+        std::string version;
+        std::string path;
+        std::shared_ptr<const OrtInference> model;
+        bool loading = false;
+        size_t memory_bytes = 0;
+        uint64_t last_used = 0;
+        uint64_t loads = 0;
+    };
+
+    OrtModelRegistryConfig config;
+    std::map<std::pair<std::string, std::string>, Entry> entries;
+    std::map<std::string, std::string> latest_versions;
+    mutable std::mutex mutex;
+    std::mutex load_mutex;
+    std::condition_variable loaded_cv;
+    uint64_t use_clock;
+    size_t memory_usage;
+
+    Entry *FindEntry(const std::string &name, const std::string &version);
+    std::shared_ptr<const OrtInference> LoadModel(const std::string &path) const;
+    void StoreModel(Entry &entry, std::shared_ptr<const OrtInference> model, size_t memoryBytes);
+    void EvictOverBudget(const Entry *keep, std::vector<std::shared_ptr<const OrtInference>> &evicted);
+
+public:
+    OrtModelRegistry(const OrtModelRegistryConfig &config = OrtModelRegistryConfig());
+    OrtModelRegistry(const OrtModelRegistry &) = delete;
+    OrtModelRegistry &operator=(const OrtModelRegistry &) = delete;
+    // A later Register of the same name becomes its default version. Registering a known
+    // (name, version) again changes the path used by its next load.
+    void Register(const std::string &name, const std::string &version, const std::string &path);
+    // Loads the model if needed. An empty version takes the latest registered one; an unknown
+    // model, or one whose file ORT rejects, returns an empty pointer. A failed load leaves the
+    // model unloaded and is retried by the next Get or Preload.
+    std::shared_ptr<const OrtInference> Get(const std::string &name, const std::string &version = std::string());
+    // Loads the given (name, version) models in parallel. An empty list loads every model.
+    void Preload(const std::vector<std::pair<std::string, std::string>> &models = std::vector<std::pair<std::string, std::string>>());
+    bool Evict(const std::string &name, const std::string &version);
+    size_t MemoryUsage() const;
+    std::vector<OrtModelInfo> List() const;
+    // Stage latency summaries of every loaded model in the Prometheus text format, labelled
+    // with model and version.
+    std::string PrometheusText() const;
+};
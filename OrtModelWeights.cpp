@@ -0,0 +1,195 @@
+#include "OrtModelWeights.h"
+#include <string.h>
+
+#include "OrtMappedFile.h"
+#include "OrtOutputView.h"
+
+// Minimal protobuf wire format reader, enough to walk ModelProto.graph.initializer.
+struct ProtoReader
+{
+    const unsigned char *position;
+    const unsigned char *end;
+
+    bool ReadVarint(uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < end; shift += 7)
+        {
+            unsigned char byte = *position++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    // Reads the next field header and, for length-delimited fields, its payload.
+    bool ReadField(uint32_t &field, uint32_t &wire_type, uint64_t &varint, const unsigned char *&payload, size_t &payload_size)
+    {
+        uint64_t key;
+        if (!ReadVarint(key))
+            return false;
+        field = (uint32_t)(key >> 3);
+        wire_type = (uint32_t)(key & 7);
+        switch (wire_type)
+        {
+        case 0:
+            return ReadVarint(varint);
+        case 1:
+            return Skip(8);
+        case 2:
+            if (!ReadVarint(varint) || varint > (uint64_t)(end - position))
+                return false;
+            payload = position;
+            payload_size = (size_t)varint;
+            position += payload_size;
+            return true;
+        case 5:
+            return Skip(4);
+        default:
+            return false;
+        }
+    }
+
+    bool Skip(size_t bytes)
+    {
+        if (bytes > (size_t)(end - position))
+            return false;
+        position += bytes;
+        return true;
+    }
+};
+
+OrtModelWeights::OrtModelWeights()
+{
+    memory_info = nullptr;
+}
+
+OrtModelWeights::~OrtModelWeights()
+{
+    for (size_t i = 0; i < values.size(); i++)
+        ort_api->ReleaseValue(values[i]);
+    for (size_t i = 0; i < buffers.size(); i++)
+        free(buffers[i]);
+    if (memory_info)
+        ort_api->ReleaseMemoryInfo(memory_info);
+}
+
+// Returns false if the file cannot be read as an ONNX model. A model without any shareable
+// initializer still loads successfully, with Count() == 0.
+bool OrtModelWeights::Load(const char *modelPath)
+{
+    OrtMappedFile model_file;
+    if (!model_file.Open(modelPath))
+        return false;
+    CheckORTError(ort_api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &memory_info));
+
+    ProtoReader reader = {(const unsigned char *)model_file.Data(), (const unsigned char *)model_file.Data() + model_file.Size()};
+    while (reader.position < reader.end)
+    {
+        uint32_t field, wire_type;
+        uint64_t varint;
+        const unsigned char *payload = nullptr;
+        size_t payload_size = 0;
+        if (!reader.ReadField(field, wire_type, varint, payload, payload_size))
+            return false;
+        // ModelProto.graph
+        if (field == 7 && wire_type == 2 && !ReadGraph(payload, payload_size))
+            return false;
+    }
+    return true;
+}
+
+bool OrtModelWeights::ReadGraph(const unsigned char *data, size_t size)
+{
+    ProtoReader reader = {data, data + size};
+    while (reader.position < reader.end)
+    {
+        uint32_t field, wire_type;
+        uint64_t varint;
+        const unsigned char *payload = nullptr;
+        size_t payload_size = 0;
+        if (!reader.ReadField(field, wire_type, varint, payload, payload_size))
+            return false;
+        // GraphProto.initializer
+        if (field == 5 && wire_type == 2 && !ReadTensor(payload, payload_size))
+            return false;
+    }
+    return true;
+}
+
+// Reads one TensorProto. Tensors that cannot be shared are skipped, not treated as errors.
+bool OrtModelWeights::ReadTensor(const unsigned char *data, size_t size)
+{
+    std::vector<int64_t> dims;
+    uint64_t data_type = 0;
+    std::string name;
+    const unsigned char *raw_data = nullptr;
+    size_t raw_size = 0;
+    bool external = false;
+
+    ProtoReader reader = {data, data + size};
+    while (reader.position < reader.end)
+    {
+        uint32_t field, wire_type;
+        uint64_t varint;
+        const unsigned char *payload = nullptr;
+        size_t payload_size = 0;
+        if (!reader.ReadField(field, wire_type, varint, payload, payload_size))
+            return false;
+        if (field == 1 && wire_type == 0)
+            dims.push_back((int64_t)varint);
+        else if (field == 1 && wire_type == 2)
+        {
+            ProtoReader packed = {payload, payload + payload_size};
+            uint64_t dim;
+            while (packed.position < packed.end && packed.ReadVarint(dim))
+                dims.push_back((int64_t)dim);
+        }
+        else if (field == 2 && wire_type == 0)
+            data_type = varint;
+        else if (field == 8 && wire_type == 2)
+            name.assign((const char *)payload, payload_size);
+        else if (field == 9 && wire_type == 2)
+        {
+            raw_data = payload;
+            raw_size = payload_size;
+        }
+        else if (field == 14 && wire_type == 0)
+            external = varint == 1;
+    }
+
+    // TensorProto.DataType numbers the types the same way as ONNXTensorElementDataType.
+    size_t element_size = OrtElementSize((ONNXTensorElementDataType)data_type);
+    if (name.empty() || !raw_data || external || element_size == 0)
+        return true;
+    size_t element_count = 1;
+    for (size_t i = 0; i < dims.size(); i++)
+        element_count *= (size_t)dims[i];
+    if (element_count * element_size != raw_size || raw_size == 0)
+        return true;
+
+    // Copied out of the mapping so the weights are aligned and the file can be closed.
+    void *buffer = malloc(raw_size);
+    if (!buffer)
+        return false;
+    memcpy(buffer, raw_data, raw_size);
+    OrtValue *value = nullptr;
+    CheckORTError(ort_api->CreateTensorWithDataAsOrtValue(memory_info, buffer, raw_size, dims.data(), dims.size(),
+                                                          (ONNXTensorElementDataType)data_type, &value));
+    names.push_back(name);
+    buffers.push_back(buffer);
+    values.push_back(value);
+    return true;
+}
+
+void OrtModelWeights::AddToSessionOptions(OrtSessionOptions *options) const
+{
+    for (size_t i = 0; i < values.size(); i++)
+        CheckORTError(ort_api->AddInitializer(options, names[i].c_str(), values[i]));
+}
+
+size_t OrtModelWeights::Count() const
+{
+    return values.size();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "OrtRuntime.h"
+
+// Initializers of an ONNX model, read once and handed to every session of that model with
+// AddInitializer. Sessions then share one copy of the weights, and ORT only shares prepacked
+// weights through a prepacked weights container for initializers added this way.
+// Tensors stored in raw_data are read; external data, string tensors and tensors stored in
+// the typed fields are left to each session to load from the model as usual.
+class OrtModelWeights
+{
+private:
+    std::vector<std::string> names;
+    std::vector<void *> buffers;
+    std::vector<OrtValue *> values;
+    OrtMemoryInfo *memory_info;
+
+    bool ReadGraph(const unsigned char *data, size_t size);
+    bool ReadTensor(const unsigned char *data, size_t size);
+
+public:
+    OrtModelWeights();
+    OrtModelWeights(const OrtModelWeights &) = delete;
+    OrtModelWeights &operator=(const OrtModelWeights &) = delete;
+    ~OrtModelWeights();
+    bool Load(const char *modelPath);
+    void AddToSessionOptions(OrtSessionOptions *options) const;
+    size_t Count() const;
+};
@@ -0,0 +1,154 @@
+#include "OrtOutputView.h"
+
+static void ReleaseOrtValue(OrtValue *value)
+{
+    if (value && ort_api)
+        ort_api->ReleaseValue(value);
+}
+
+OrtValuePtr MakeOrtValuePtr(OrtValue *value)
+{
+    return OrtValuePtr(value, ReleaseOrtValue);
+}
+
+size_t OrtElementSize(ONNXTensorElementDataType elementType)
+{
+    switch (elementType)
+    {
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT8:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL:
+        return 1;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT16:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT16:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_BFLOAT16:
+        return 2;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT32:
+        return 4;
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64:
+    case ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+std::string OrtStringTensorView::operator[](size_t i) const
+{
+    size_t length;
+    CheckORTError(ort_api->GetStringTensorElementLength(value.get(), i, &length));
+    std::string element(length, '\0');
+    if (length > 0)
+        CheckORTError(ort_api->GetStringTensorElement(value.get(), length, i, &element[0]));
+    return element;
+}
+
+OrtOutput::OrtOutput()
+{
+    onnx_type = ONNX_TYPE_UNKNOWN;
+    element_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    element_count = 0;
+}
+
+OrtOutput::OrtOutput(OrtValue *value)
+    : OrtOutput(MakeOrtValuePtr(value))
+{
+}
+
+OrtOutput::OrtOutput(const OrtValuePtr &value)
+    : OrtOutput()
+{
+    this->value = value;
+    if (!value)
+        return;
+
+    OrtTypeInfo *type_info;
+    CheckORTError(ort_api->GetTypeInfo(value.get(), &type_info));
+    CheckORTError(ort_api->GetOnnxTypeFromTypeInfo(type_info, &onnx_type));
+    ort_api->ReleaseTypeInfo(type_info);
+    if (onnx_type != ONNX_TYPE_TENSOR)
+        return;
+
+    OrtTensorTypeAndShapeInfo *tensor_info;
+    size_t dims_count;
+    CheckORTError(ort_api->GetTensorTypeAndShape(value.get(), &tensor_info));
+    CheckORTError(ort_api->GetTensorElementType(tensor_info, &element_type));
+    CheckORTError(ort_api->GetTensorShapeElementCount(tensor_info, &element_count));
+    CheckORTError(ort_api->GetDimensionsCount(tensor_info, &dims_count));
+    shape.resize(dims_count);
+    CheckORTError(ort_api->GetDimensions(tensor_info, shape.data(), dims_count));
+    ort_api->ReleaseTensorTypeAndShapeInfo(tensor_info);
+}
+
+ONNXType OrtOutput::Type() const
+{
+    return onnx_type;
+}
+
+ONNXTensorElementDataType OrtOutput::ElementType() const
+{
+    return element_type;
+}
+
+const std::vector<int64_t> &OrtOutput::Shape() const
+{
+    return shape;
+}
+
+OrtValue *OrtOutput::Value() const
+{
+    return value.get();
+}
+
+OrtStringTensorView OrtOutput::AsStrings() const
+{
+    if (onnx_type != ONNX_TYPE_TENSOR || element_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_STRING)
+        return OrtStringTensorView();
+    return OrtStringTensorView(value, element_count, shape);
+}
+
+size_t OrtOutput::SequenceLength() const
+{
+    if (onnx_type != ONNX_TYPE_SEQUENCE)
+        return 0;
+    size_t length;
+    CheckORTError(ort_api->GetValueCount(value.get(), &length));
+    return length;
+}
+
+OrtOutput OrtOutput::SequenceElement(size_t i) const
+{
+    if (onnx_type != ONNX_TYPE_SEQUENCE)
+        return OrtOutput();
+    OrtAllocator *allocator;
+    OrtValue *element;
+    CheckORTError(ort_api->GetAllocatorWithDefaultOptions(&allocator));
+    CheckORTError(ort_api->GetValue(value.get(), static_cast<int>(i), allocator, &element));
+    return OrtOutput(element);
+}
+
+OrtOutput OrtOutput::MapKeys() const
+{
+    if (onnx_type != ONNX_TYPE_MAP)
+        return OrtOutput();
+    OrtAllocator *allocator;
+    OrtValue *keys;
+    CheckORTError(ort_api->GetAllocatorWithDefaultOptions(&allocator));
+    CheckORTError(ort_api->GetValue(value.get(), 0, allocator, &keys));
+    return OrtOutput(keys);
+}
+
+OrtOutput OrtOutput::MapValues() const
+{
+    if (onnx_type != ONNX_TYPE_MAP)
+        return OrtOutput();
+    OrtAllocator *allocator;
+    OrtValue *values;
+    CheckORTError(ort_api->GetAllocatorWithDefaultOptions(&allocator));
+    CheckORTError(ort_api->GetValue(value.get(), 1, allocator, &values));
+    return OrtOutput(values);
+}
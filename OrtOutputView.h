@@ -0,0 +1,134 @@
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OrtRuntime.h"
+
+// Shared ownership of an OrtValue; the value is released with the last reference.
+typedef std::shared_ptr<OrtValue> OrtValuePtr;
+OrtValuePtr MakeOrtValuePtr(OrtValue *value);
+
+template <typename T>
+struct OrtElementType;
+template <>
+struct OrtElementType<float>
+{
+    static const ONNXTensorElementDataType value = ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+};
+template <>
+struct OrtElementType<double>
+{
+    static const ONNXTensorElementDataType value = ONNX_TENSOR_ELEMENT_DATA_TYPE_DOUBLE;
+};
+template <>
+struct OrtElementType<int32_t>
+{
+    static const ONNXTensorElementDataType value = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT32;
+};
+template <>
+struct OrtElementType<int64_t>
+{
+    static const ONNXTensorElementDataType value = ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64;
+};
+template <>
+struct OrtElementType<uint8_t>
+{
+    static const ONNXTensorElementDataType value = ONNX_TENSOR_ELEMENT_DATA_TYPE_UINT8;
+};
+template <>
+struct OrtElementType<bool>
+{
+    static const ONNXTensorElementDataType value = ONNX_TENSOR_ELEMENT_DATA_TYPE_BOOL;
+};
+
+// Byte size of one element of the type; 0 for strings and the types not stored as plain
+// values (e.g. complex).
+size_t OrtElementSize(ONNXTensorElementDataType elementType);
+
+// Read-only view of a numeric output tensor. Points straight into the tensor's buffer and
+// keeps the OrtValue alive, so it stays valid after the context or plan runs again.
+template <typename T>
+class OrtTensorView
+{
+private:
+    OrtValuePtr value;
+    const T *data_ptr;
+    size_t element_count;
+    std::vector<int64_t> shape;
+
+public:
+    OrtTensorView() : data_ptr(nullptr), element_count(0) {}
+    OrtTensorView(const OrtValuePtr &value, const T *data, size_t count, const std::vector<int64_t> &shape)
+        : value(value), data_ptr(data), element_count(count), shape(shape) {}
+
+    const T *data() const { return data_ptr; }
+    size_t size() const { return element_count; }
+    bool empty() const { return element_count == 0; }
+    const T *begin() const { return data_ptr; }
+    const T *end() const { return data_ptr + element_count; }
+    const T &operator[](size_t i) const { return data_ptr[i]; }
+    const std::vector<int64_t> &Shape() const { return shape; }
+};
+
+// View of a string output tensor. ORT only hands out copies of string elements, so each
+// access copies that one element; the tensor itself is not copied.
+class OrtStringTensorView
+{
+private:
+    OrtValuePtr value;
+    size_t element_count;
+    std::vector<int64_t> shape;
+
+public:
+    OrtStringTensorView() : element_count(0) {}
+    OrtStringTensorView(const OrtValuePtr &value, size_t count, const std::vector<int64_t> &shape)
+        : value(value), element_count(count), shape(shape) {}
+
+    size_t size() const { return element_count; }
+    bool empty() const { return element_count == 0; }
+    std::string operator[](size_t i) const;
+    const std::vector<int64_t> &Shape() const { return shape; }
+};
+
+// One model output with its type resolved. AsTensor<T>() returns an empty view when the
+// element type does not match T, so callers never reinterpret the buffer.
+class OrtOutput
+{
+private:
+    OrtValuePtr value;
+    ONNXType onnx_type;
+    ONNXTensorElementDataType element_type;
+    size_t element_count;
+    std::vector<int64_t> shape;
+
+public:
+    OrtOutput();
+    explicit OrtOutput(OrtValue *value);
+    explicit OrtOutput(const OrtValuePtr &value);
+    ONNXType Type() const;
+    ONNXTensorElementDataType ElementType() const;
+    const std::vector<int64_t> &Shape() const;
+    OrtValue *Value() const;
+
+    template <typename T>
+    OrtTensorView<T> AsTensor() const
+    {
+        if (onnx_type != ONNX_TYPE_TENSOR || element_type != OrtElementType<T>::value)
+            return OrtTensorView<T>();
+        T *data;
+        CheckORTError(ort_api->GetTensorMutableData(value.get(), (void **)(&data)));
+        return OrtTensorView<T>(value, data, element_count, shape);
+    }
+
+    OrtStringTensorView AsStrings() const;
+
+    // For sequence outputs: number of elements, and element i (for the classifiers' ZipMap
+    // output, the map of row i). ORT builds sequence elements on request.
+    size_t SequenceLength() const;
+    OrtOutput SequenceElement(size_t i) const;
+    // For map outputs: the keys (index 0) or values (index 1) tensor.
+    OrtOutput MapKeys() const;
+    OrtOutput MapValues() const;
+};
@@ -0,0 +1,296 @@
+#include "OrtProfileSummary.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+// The fields of one trace event the summary needs.
+struct OrtTraceEvent
+{
+    std::string category;
+    std::string name;
+    std::string op_name;
+    double duration_us = 0;
+};
+
+// Minimal reader for the JSON ORT writes: an array of flat event objects whose "args" object
+// holds the op_name. Values it does not need are skipped without being decoded.
+static void SkipSpace(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        p++;
+}
+
+static bool ReadString(const char *&p, const char *end, std::string &out)
+{
+    SkipSpace(p, end);
+    if (p >= end || *p != '"')
+        return false;
+    out.clear();
+    for (p++; p < end; p++)
+    {
+        if (*p == '"')
+        {
+            p++;
+            return true;
+        }
+        if (*p == '\\' && p + 1 < end)
+            p++;
+        out += *p;
+    }
+    return false;
+}
+
+static bool SkipValue(const char *&p, const char *end)
+{
+    SkipSpace(p, end);
+    if (p >= end)
+        return false;
+    if (*p == '"')
+    {
+        std::string ignored;
+        return ReadString(p, end, ignored);
+    }
+    if (*p == '{' || *p == '[')
+    {
+        char close = *p == '{' ? '}' : ']';
+        p++;
+        SkipSpace(p, end);
+        if (p < end && *p == close)
+        {
+            p++;
+            return true;
+        }
+        while (p < end)
+        {
+            if (close == '}')
+            {
+                std::string key;
+                if (!ReadString(p, end, key))
+                    return false;
+                SkipSpace(p, end);
+                if (p >= end || *p++ != ':')
+                    return false;
+            }
+            if (!SkipValue(p, end))
+                return false;
+            SkipSpace(p, end);
+            if (p < end && *p == ',')
+                p++;
+            else if (p < end && *p == close)
+            {
+                p++;
+                return true;
+            }
+            else
+                return false;
+        }
+        return false;
+    }
+    // Number, true, false or null.
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\r' && *p != '\n')
+        p++;
+    return true;
+}
+
+// Reads an object, calling readValue with each key while positioned at its value.
+template <typename ValueReader>
+static bool ReadObject(const char *&p, const char *end, ValueReader readValue)
+{
+    SkipSpace(p, end);
+    if (p >= end || *p++ != '{')
+        return false;
+    SkipSpace(p, end);
+    if (p < end && *p == '}')
+    {
+        p++;
+        return true;
+    }
+    while (p < end)
+    {
+        std::string key;
+        if (!ReadString(p, end, key))
+            return false;
+        SkipSpace(p, end);
+        if (p >= end || *p++ != ':')
+            return false;
+        if (!readValue(key))
+            return false;
+        SkipSpace(p, end);
+        if (p < end && *p == ',')
+            p++;
+        else if (p < end && *p == '}')
+        {
+            p++;
+            return true;
+        }
+        else
+            return false;
+    }
+    return false;
+}
+
+static bool ReadEvent(const char *&p, const char *end, OrtTraceEvent &event)
+{
+    return ReadObject(p, end, [&](const std::string &key) {
+        if (key == "cat")
+            return ReadString(p, end, event.category);
+        if (key == "name")
+            return ReadString(p, end, event.name);
+        if (key == "dur")
+        {
+            SkipSpace(p, end);
+            char *number_end = nullptr;
+            event.duration_us = strtod(p, &number_end);
+            if (number_end == p)
+                return false;
+            p = number_end;
+            return true;
+        }
+        if (key == "args")
+        {
+            SkipSpace(p, end);
+            if (p < end && *p != '{')
+                return SkipValue(p, end);
+            return ReadObject(p, end, [&](const std::string &argKey) {
+                if (argKey == "op_name")
+                    return ReadString(p, end, event.op_name);
+                return SkipValue(p, end);
+            });
+        }
+        return SkipValue(p, end);
+    });
+}
+
+static bool EndsWith(const std::string &text, const char *suffix)
+{
+    size_t suffix_length = strlen(suffix);
+    return text.size() >= suffix_length && text.compare(text.size() - suffix_length, suffix_length, suffix) == 0;
+}
+
+OrtProfileSummary::OrtProfileSummary()
+{
+    run_count = 0;
+    run_total_us = 0;
+}
+
+bool OrtProfileSummary::Load(const char *tracePath)
+{
+    operators.clear();
+    run_count = 0;
+    run_total_us = 0;
+
+    FILE *file = fopen(tracePath, "rb");
+    if (!file)
+    {
+        printf("Failed to open profile %s\n", tracePath);
+        return false;
+    }
+    std::string trace;
+    char chunk[65536];
+    size_t read_size;
+    while ((read_size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        trace.append(chunk, read_size);
+    fclose(file);
+
+    const char *p = trace.data();
+    const char *end = p + trace.size();
+    SkipSpace(p, end);
+    if (p >= end || *p++ != '[')
+    {
+        printf("Profile %s is not a trace array.\n", tracePath);
+        return false;
+    }
+
+    std::map<std::string, std::vector<double>> durations;
+    SkipSpace(p, end);
+    while (p < end && *p != ']')
+    {
+        OrtTraceEvent event;
+        if (!ReadEvent(p, end, event))
+        {
+            printf("Malformed event in profile %s\n", tracePath);
+            return false;
+        }
+        if (event.category == "Session" && event.name == "model_run")
+        {
+            run_count++;
+            run_total_us += event.duration_us;
+        }
+        else if (event.category == "Node" && EndsWith(event.name, "_kernel_time"))
+            durations[event.op_name.empty() ? event.name : event.op_name].push_back(event.duration_us);
+        SkipSpace(p, end);
+        if (p < end && *p == ',')
+            p++;
+        SkipSpace(p, end);
+    }
+
+    for (std::map<std::string, std::vector<double>>::iterator it = durations.begin(); it != durations.end(); ++it)
+    {
+        std::vector<double> &values = it->second;
+        std::sort(values.begin(), values.end());
+        OrtOperatorProfile profile;
+        profile.op_type = it->first;
+        profile.count = values.size();
+        for (size_t i = 0; i < values.size(); i++)
+            profile.total_us += values[i];
+        profile.mean_us = profile.total_us / values.size();
+        size_t rank = (size_t)ceil(0.99 * values.size());
+        profile.p99_us = values[rank > 0 ? rank - 1 : 0];
+        profile.share = run_total_us > 0 ? profile.total_us / run_total_us : 0;
+        operators.push_back(profile);
+    }
+    std::sort(operators.begin(), operators.end(), [](const OrtOperatorProfile &a, const OrtOperatorProfile &b) {
+        return a.total_us > b.total_us;
+    });
+    return true;
+}
+
+const std::vector<OrtOperatorProfile> &OrtProfileSummary::Operators() const
+{
+    return operators;
+}
+
+size_t OrtProfileSummary::RunCount() const
+{
+    return run_count;
+}
+
+double OrtProfileSummary::RunTotalUs() const
+{
+    return run_total_us;
+}
+
+void OrtProfileSummary::Print() const
+{
+    printf("%zu runs, %.1f us in total\n", run_count, run_total_us);
+    printf("%-28s %8s %12s %10s %10s %7s\n", "Operator", "Count", "Total(us)", "Mean(us)", "P99(us)", "Share");
+    for (size_t i = 0; i < operators.size(); i++)
+    {
+        const OrtOperatorProfile &profile = operators[i];
+        printf("%-28s %8zu %12.1f %10.2f %10.2f %6.1f%%\n", profile.op_type.c_str(), profile.count, profile.total_us,
+               profile.mean_us, profile.p99_us, profile.share * 100);
+    }
+}
+
+bool OrtProfileSummary::WriteCsv(const char *csvPath) const
+{
+    FILE *file = fopen(csvPath, "w");
+    if (!file)
+    {
+        printf("Failed to open %s\n", csvPath);
+        return false;
+    }
+    fprintf(file, "operator,count,total_us,mean_us,p99_us,share\n");
+    for (size_t i = 0; i < operators.size(); i++)
+    {
+        const OrtOperatorProfile &profile = operators[i];
+        fprintf(file, "%s,%zu,%.3f,%.3f,%.3f,%.6f\n", profile.op_type.c_str(), profile.count, profile.total_us,
+                profile.mean_us, profile.p99_us, profile.share);
+    }
+    bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
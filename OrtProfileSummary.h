@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Kernel time of one operator type over every node of that type in the trace.
+struct OrtOperatorProfile
+{
+    std::string op_type;
+    size_t count = 0;
+    double total_us = 0;
+    double mean_us = 0;
+    double p99_us = 0;
+    // Fraction of the summed model_run time spent in this operator.
+    double share = 0;
+};
+
+// Per-operator summary of an ORT profiling trace, as written after
+// OrtSessionConfig::profile_file_prefix and OrtInference::EndProfiling(). Node events are
+// grouped by their op_name; session load and initialization events are not counted.
+class OrtProfileSummary
+{
+private:
+    std::vector<OrtOperatorProfile> operators;
+    size_t run_count;
+    double run_total_us;
+
+public:
+    OrtProfileSummary();
+    // Parses the trace; returns false, leaving the summary empty, if it cannot be read.
+    bool Load(const char *tracePath);
+    // Sorted by total time, largest first.
+    const std::vector<OrtOperatorProfile> &Operators() const;
+    size_t RunCount() const;
+    double RunTotalUs() const;
+    void Print() const;
+    bool WriteCsv(const char *csvPath) const;
+};
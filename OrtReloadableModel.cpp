@@ -0,0 +1,170 @@
+#include "OrtReloadableModel.h"
+#include <sys/stat.h>
+
+OrtReloadableModel::OrtReloadableModel(const char *modelPath, const OrtReloadConfig &config)
+    : model_path(modelPath), config(config)
+{
+    reload_requested = false;
+    stopping = false;
+    ReadFileStamp(loaded_stamp);
+    std::shared_ptr<const OrtInference> first = LoadModel();
+    // There is no earlier session to keep serving, so this fails like any other load.
+    if (!first)
+        exit(1);
+    std::atomic_store(&current, first);
+    generation = 1;
+    background = std::thread(&OrtReloadableModel::BackgroundLoop, this);
+}
+
+OrtReloadableModel::~OrtReloadableModel()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeup_mutex);
+        stopping = true;
+    }
+    wakeup_cv.notify_one();
+    if (background.joinable())
+        background.join();
+    // Sessions still held by callers are released when they drop them.
+    retired.clear();
+    std::atomic_store(&current, std::shared_ptr<const OrtInference>());
+}
+
+std::shared_ptr<const OrtInference> OrtReloadableModel::Acquire() const
+{
+    return std::atomic_load(&current);
+}
+
+size_t OrtReloadableModel::RunBatchInference(const float *inputData, size_t batchSize, std::vector<float> &outputData) const
+{
+    return Acquire()->RunBatchInference(inputData, batchSize, outputData);
+}
+
+// Builds the new session on the calling thread and swaps it in. Calls already running keep
+// the session they acquired. Returns false, and keeps serving the current session, if the
+// model file cannot be read or loaded.
+bool OrtReloadableModel::Reload()
+{
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    if (!ReadFileStamp(loaded_stamp))
+    {
+        printf("Reload skipped, cannot read %s.\n", model_path.c_str());
+        return false;
+    }
+    std::shared_ptr<const OrtInference> next = LoadModel();
+    if (!next)
+    {
+        printf("Reload of %s failed, keeping generation %llu.\n", model_path.c_str(), (unsigned long long)generation.load());
+        return false;
+    }
+    std::shared_ptr<const OrtInference> previous = std::atomic_exchange(&current, next);
+    retired.push_back(previous);
+    generation++;
+    printf("Reloaded %s, generation %llu.\n", model_path.c_str(), (unsigned long long)generation.load());
+    return true;
+}
+
+// Reloads on the background thread instead of the caller's.
+void OrtReloadableModel::RequestReload()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeup_mutex);
+        reload_requested = true;
+    }
+    wakeup_cv.notify_one();
+}
+
+uint64_t OrtReloadableModel::Generation() const
+{
+    return generation.load();
+}
+
+std::shared_ptr<const OrtInference> OrtReloadableModel::LoadModel() const
+{
+    OrtInference *inference = new OrtInference();
+    inference->LoadONNXRuntimeLibrary();
+    inference->InitializeONNXEnvironment();
+    if (!inference->TryCreateSessionAndLoadModel(model_path.c_str(), config.session_config))
+    {
+        delete inference;
+        return std::shared_ptr<const OrtInference>();
+    }
+    inference->GetInputOutputInfo();
+    if (config.warmup)
+        inference->Warmup(config.warmup_config);
+    return std::shared_ptr<const OrtInference>(inference);
+}
+
+// Size and modification time of the model file, as one comparable string.
+bool OrtReloadableModel::ReadFileStamp(std::string &stamp) const
+{
+    struct stat model_stat;
+    if (stat(model_path.c_str(), &model_stat) != 0)
+        return false;
+    stamp = std::to_string((long long)model_stat.st_size) + ":" + std::to_string((long long)model_stat.st_mtime);
+#ifdef __linux__
+    stamp += "." + std::to_string((long long)model_stat.st_mtim.tv_nsec);
+#endif
+    return true;
+}
+
+// A retired session no longer reachable through current is only referenced by callers that
+// acquired it earlier; once the list holds the last reference, nobody is running on it.
+void OrtReloadableModel::ReleaseRetired()
+{
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    for (size_t i = 0; i < retired.size();)
+    {
+        if (retired[i].use_count() == 1)
+        {
+            retired[i] = retired.back();
+            retired.pop_back();
+        }
+        else
+            i++;
+    }
+}
+
+void OrtReloadableModel::BackgroundLoop()
+{
+    std::string pending_stamp;
+    while (true)
+    {
+        bool reload = false;
+        {
+            std::unique_lock<std::mutex> lock(wakeup_mutex);
+            // Wakes up at least every 100 ms to release retired sessions.
+            int wait_ms = config.watch_interval_ms > 0 ? config.watch_interval_ms : 100;
+            wakeup_cv.wait_for(lock, std::chrono::milliseconds(wait_ms), [this] { return stopping || reload_requested; });
+            if (stopping)
+                return;
+            reload = reload_requested;
+            reload_requested = false;
+        }
+
+        if (!reload && config.watch_interval_ms > 0)
+        {
+            // A file still being written changes between polls, so only reload once the
+            // stamp seen on the previous poll is still the same.
+            std::string stamp;
+            bool changed = false;
+            if (ReadFileStamp(stamp))
+            {
+                std::lock_guard<std::mutex> lock(reload_mutex);
+                changed = stamp != loaded_stamp;
+            }
+            if (changed)
+            {
+                reload = stamp == pending_stamp;
+                pending_stamp = stamp;
+            }
+        }
+
+        if (reload)
+        {
+            Reload();
+            pending_stamp.clear();
+        }
+        ReleaseRetired();
+    }
+}
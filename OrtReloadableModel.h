@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OrtInference.h"
+
+struct OrtReloadConfig
+{
+    OrtSessionConfig session_config;
+    // Warm the new session up before it is swapped in.
+    bool warmup = true;
+    OrtWarmupConfig warmup_config;
+    // Poll the model file this often and reload once a change has stopped changing for one
+    // interval; 0 disables the watcher, leaving Reload() and RequestReload().
+    int watch_interval_ms = 0;
+};
+
+// A model that can be replaced while serving. Callers take the current session with
+// Acquire() and keep it alive for as long as they hold the pointer. A reload builds and
+// warms the new session off the request path, publishes it with one atomic pointer store,
+// and the background thread releases the old one once the last in-flight call drops it.
+// A reload that fails, e.g. on a corrupt or truncated file, keeps the current session;
+// only a failed first load in the constructor exits like every other load.
+class OrtReloadableModel
+{
+private:
+    std::string model_path;
+    OrtReloadConfig config;
+    std::shared_ptr<const OrtInference> current;
+    std::vector<std::shared_ptr<const OrtInference>> retired;
+    std::atomic<uint64_t> generation;
+    std::mutex reload_mutex;
+    // Stamp of the file the last load attempt read, guarded by reload_mutex. The watcher only
+    // reloads once the file differs from it, so a file that failed to load waits for a change.
+    std::string loaded_stamp;
+    std::mutex wakeup_mutex;
+    std::condition_variable wakeup_cv;
+    bool reload_requested;
+    bool stopping;
+    std::thread background;
+
+    std::shared_ptr<const OrtInference> LoadModel() const;
+    bool ReadFileStamp(std::string &stamp) const;
+    void ReleaseRetired();
+    void BackgroundLoop();
+
+public:
+    OrtReloadableModel(const char *modelPath, const OrtReloadConfig &config = OrtReloadConfig());
+    OrtReloadableModel(const OrtReloadableModel &) = delete;
+    OrtReloadableModel &operator=(const OrtReloadableModel &) = delete;
+    ~OrtReloadableModel();
+    std::shared_ptr<const OrtInference> Acquire() const;
+    size_t RunBatchInference(const float *inputData, size_t batchSize, std::vector<float> &outputData) const;
+    bool Reload();
+    void RequestReload();
+    // Starts at 1 and increases with every successful reload.
+    uint64_t Generation() const;
+};
@@ -0,0 +1,298 @@
+#include "OrtRuntime.h"
+#include <sys/stat.h>
+
+#include "OrtModelWeights.h"
+#include "OrtTensorAllocator.h"
+
+#ifdef _WIN32
+#define LoadDynamicLibrary(path) LoadLibraryA(path)
+#define GetFunctionFromLibrary(lib_ptr, func_name) GetProcAddress(lib_ptr, func_name)
+#define FreeDynamicLibrary(lib_ptr) FreeLibrary(lib_ptr)
+char DefaultLibraryPath[] = "./onnxruntime.dll";
+#elif __linux__
+#define LoadDynamicLibrary(path) dlopen(path, RTLD_NOW)
+#define GetFunctionFromLibrary(lib_ptr, func_name) dlsym(lib_ptr, func_name)
+#define FreeDynamicLibrary(lib_ptr) dlclose(lib_ptr)
+char DefaultLibraryPath[] = "./libonnxruntime.so.1.15.1";
+#elif __APPLE__
+#define LoadDynamicLibrary(path) dlopen(path, RTLD_NOW)
+#define GetFunctionFromLibrary(lib_ptr, func_name) dlsym(lib_ptr, func_name)
+#define FreeDynamicLibrary(lib_ptr) dlclose(lib_ptr)
+char DefaultLibraryPath[] = "./libonnxruntime.1.15.1.dylib";
+#else
+#define LoadDynamicLibrary(path) (nullptr)
+#define GetFunctionFromLibrary(lib_ptr, func_name) (nullptr)
+#define FreeDynamicLibrary(lib_ptr) ((void)0)
+#endif
+
+// A global pointer to the OrtApi.
+const OrtApi *ort_api = NULL;
+
+typedef const OrtApiBase *(*GetOrtApiBaseFunction)(void);
+void InternalORTErrorCheck(OrtStatus *status, const char *text,
+                           const char *file, int line)
+{
+    if (!status)
+        return;
+    printf("Got onnxruntime error %s, (%s at line %d in %s)\n",
+           ort_api->GetErrorMessage(status), text, line, file);
+    ort_api->ReleaseStatus(status);
+    exit(1);
+}
+
+std::mutex OrtRuntime::mutex;
+OrtRuntime *OrtRuntime::instance = nullptr;
+
+OrtRuntime::OrtRuntime()
+{
+    library_ptr = nullptr;
+    ort_env = nullptr;
+    prepacked_weights = nullptr;
+    global_thread_pools = false;
+    env_allocator = false;
+    tensor_allocator = nullptr;
+    ref_count = 0;
+    api_version = 0;
+}
+
+OrtRuntime::~OrtRuntime()
+{
+    shared_weights.clear();
+    if (prepacked_weights)
+        ort_api->ReleasePrepackedWeightsContainer(prepacked_weights);
+    prepacked_weights = nullptr;
+    if (ort_env)
+        ort_api->ReleaseEnv(ort_env);
+    ort_env = nullptr;
+    // Registered with the env, so it has to outlive it.
+    delete tensor_allocator;
+    tensor_allocator = nullptr;
+    ort_api = NULL;
+    if (library_ptr)
+        FreeDynamicLibrary(library_ptr);
+    library_ptr = nullptr;
+}
+
+OrtRuntime *OrtRuntime::Acquire()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (instance)
+    {
+        instance->ref_count++;
+        return instance;
+    }
+
+    LIB_PTR library_ptr = LoadDynamicLibrary(DefaultLibraryPath);
+    if (!library_ptr)
+    {
+        printf("Failed to load the onnxruntime library.\n");
+        return nullptr;
+    }
+
+    GetOrtApiBaseFunction get_api_base_fn = reinterpret_cast<GetOrtApiBaseFunction>(GetFunctionFromLibrary(library_ptr, "OrtGetApiBase"));
+    if (!get_api_base_fn)
+    {
+        printf("Failed to find Get API base function.\n");
+        FreeDynamicLibrary(library_ptr);
+        return nullptr;
+    }
+
+    // A library older than the headers returns no API for ORT_API_VERSION. The wrapper only
+    // needs OrtMinimumApiVersion, so step down and leave newer features (RunAsync) disabled.
+    const OrtApiBase *api_base = get_api_base_fn();
+    uint32_t api_version = ORT_API_VERSION;
+    ort_api = api_base->GetApi(api_version);
+    while (!ort_api && api_version > OrtMinimumApiVersion)
+        ort_api = api_base->GetApi(--api_version);
+    if (!ort_api)
+    {
+        printf("onnxruntime %s is older than API version %u.\n", api_base->GetVersionString(), OrtMinimumApiVersion);
+        FreeDynamicLibrary(library_ptr);
+        return nullptr;
+    }
+
+    instance = new OrtRuntime();
+    instance->library_ptr = library_ptr;
+    instance->api_version = api_version;
+    instance->version_string = api_base->GetVersionString();
+    instance->ref_count = 1;
+    return instance;
+}
+
+void OrtRuntime::Release()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!instance || --instance->ref_count > 0)
+        return;
+    delete instance;
+    instance = nullptr;
+}
+
+// Creates the env on first use; later calls return the same env and ignore their config.
+OrtEnv *OrtRuntime::InitializeEnvironment(const OrtEnvConfig &config)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ort_env)
+        return ort_env;
+
+    global_thread_pools = config.use_global_thread_pools;
+    if (!global_thread_pools)
+    {
+        CheckORTError(ort_api->CreateEnv(ORT_LOGGING_LEVEL_FATAL, "Example", &ort_env));
+        if (config.register_tensor_allocator)
+            RegisterTensorAllocator(config.tensor_allocator);
+        else if (config.register_cpu_arena)
+            RegisterCpuArena(config.cpu_arena);
+        return ort_env;
+    }
+
+    OrtThreadingOptions *threading_options;
+    CheckORTError(ort_api->CreateThreadingOptions(&threading_options));
+    if (config.global_intra_op_num_threads > 0)
+        CheckORTError(ort_api->SetGlobalIntraOpNumThreads(threading_options, config.global_intra_op_num_threads));
+    if (config.global_inter_op_num_threads > 0)
+        CheckORTError(ort_api->SetGlobalInterOpNumThreads(threading_options, config.global_inter_op_num_threads));
+    if (config.global_spin_control >= 0)
+        CheckORTError(ort_api->SetGlobalSpinControl(threading_options, config.global_spin_control));
+    if (!config.global_intra_op_thread_affinity.empty())
+        CheckORTError(ort_api->SetGlobalIntraOpThreadAffinity(threading_options, config.global_intra_op_thread_affinity.c_str()));
+    CheckORTError(ort_api->CreateEnvWithGlobalThreadPools(ORT_LOGGING_LEVEL_FATAL, "Example", threading_options, &ort_env));
+    ort_api->ReleaseThreadingOptions(threading_options);
+    if (config.register_tensor_allocator)
+        RegisterTensorAllocator(config.tensor_allocator);
+    else if (config.register_cpu_arena)
+        RegisterCpuArena(config.cpu_arena);
+    return ort_env;
+}
+
+// Builds the arena config from the non-default settings and registers the arena on the env.
+void OrtRuntime::RegisterCpuArena(const OrtArenaConfig &config)
+{
+    std::vector<const char *> keys;
+    std::vector<size_t> values;
+    if (config.max_mem > 0)
+    {
+        keys.push_back("max_mem");
+        values.push_back(config.max_mem);
+    }
+    if (config.arena_extend_strategy >= 0)
+    {
+        keys.push_back("arena_extend_strategy");
+        values.push_back((size_t)config.arena_extend_strategy);
+    }
+    if (config.initial_chunk_size_bytes > 0)
+    {
+        keys.push_back("initial_chunk_size_bytes");
+        values.push_back(config.initial_chunk_size_bytes);
+    }
+    if (config.max_dead_bytes_per_chunk > 0)
+    {
+        keys.push_back("max_dead_bytes_per_chunk");
+        values.push_back(config.max_dead_bytes_per_chunk);
+    }
+    if (config.initial_growth_chunk_size_bytes > 0)
+    {
+        keys.push_back("initial_growth_chunk_size_bytes");
+        values.push_back(config.initial_growth_chunk_size_bytes);
+    }
+
+    OrtArenaCfg *arena_cfg = nullptr;
+    OrtMemoryInfo *arena_memory_info = nullptr;
+    CheckORTError(ort_api->CreateArenaCfgV2(keys.data(), values.data(), keys.size(), &arena_cfg));
+    CheckORTError(ort_api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &arena_memory_info));
+    CheckORTError(ort_api->CreateAndRegisterAllocator(ort_env, arena_memory_info, arena_cfg));
+    ort_api->ReleaseMemoryInfo(arena_memory_info);
+    ort_api->ReleaseArenaCfg(arena_cfg);
+    env_allocator = true;
+}
+
+bool OrtRuntime::UsesGlobalThreadPools() const
+{
+    return global_thread_pools;
+}
+
+void OrtRuntime::RegisterTensorAllocator(const OrtTensorAllocatorConfig &config)
+{
+    tensor_allocator = new OrtTensorAllocator(config);
+    CheckORTError(ort_api->RegisterAllocator(ort_env, tensor_allocator));
+    env_allocator = true;
+}
+
+bool OrtRuntime::HasEnvAllocator() const
+{
+    return env_allocator;
+}
+
+void OrtRuntime::EnsureEnvAllocator()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ort_env && !env_allocator)
+        RegisterCpuArena(OrtArenaConfig());
+}
+
+OrtAllocator *OrtRuntime::TensorAllocator() const
+{
+    return tensor_allocator;
+}
+
+OrtTensorAllocatorStats OrtRuntime::TensorAllocatorStats() const
+{
+    return tensor_allocator ? tensor_allocator->GetStats() : OrtTensorAllocatorStats();
+}
+
+uint32_t OrtRuntime::ApiVersion() const
+{
+    return api_version;
+}
+
+const char *OrtRuntime::VersionString() const
+{
+    return version_string.c_str();
+}
+
+OrtPrepackedWeightsContainer *OrtRuntime::PrepackedWeightsContainer()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!prepacked_weights)
+        CheckORTError(ort_api->CreatePrepackedWeightsContainer(&prepacked_weights));
+    return prepacked_weights;
+}
+
+std::shared_ptr<const OrtModelWeights> OrtRuntime::SharedModelWeights(const char *modelPath)
+{
+    struct stat model_stat;
+    if (stat(modelPath, &model_stat) != 0)
+        return std::shared_ptr<const OrtModelWeights>();
+    // A file replaced by rename gets a new inode, one rewritten in place a new mtime and
+    // ctime. The ctime also changes when a copy keeps the old mtime (cp -p, rsync -t).
+    std::string key = std::string(modelPath) + "|" + std::to_string((unsigned long long)model_stat.st_dev) + ":" +
+                      std::to_string((unsigned long long)model_stat.st_ino) + "|" + std::to_string((long long)model_stat.st_size) + "|" +
+                      std::to_string((long long)model_stat.st_mtime) + "|" + std::to_string((long long)model_stat.st_ctime);
+#ifdef __linux__
+    key += "|" + std::to_string((long long)model_stat.st_mtim.tv_nsec) + "|" + std::to_string((long long)model_stat.st_ctim.tv_nsec);
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const OrtModelWeights> weights = shared_weights[key].lock();
+    if (weights)
+        return weights;
+    for (std::map<std::string, std::weak_ptr<const OrtModelWeights>>::iterator it = shared_weights.begin(); it != shared_weights.end();)
+    {
+        if (it->second.expired() && it->first != key)
+            it = shared_weights.erase(it);
+        else
+            ++it;
+    }
+
+    OrtModelWeights *loaded = new OrtModelWeights();
+    if (!loaded->Load(modelPath))
+    {
+        printf("Failed to read initializers of %s.\n", modelPath);
+        delete loaded;
+        shared_weights.erase(key);
+        return std::shared_ptr<const OrtModelWeights>();
+    }
+    weights.reset(loaded);
+    shared_weights[key] = weights;
+    return weights;
+}
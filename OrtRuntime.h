@@ -0,0 +1,160 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32) && defined(__GNUC__)
+#undef _WIN32
+#include "onnxruntime_c_api.h"
+#define _WIN32
+#else
+#include "onnxruntime_c_api.h"
+#endif
+
+#ifdef _WIN32
+#include <Windows.h>
+#define LIB_PTR HMODULE
+#elif __linux__
+#include <dlfcn.h>
+#define LIB_PTR void *
+#elif __APPLE__
+#include <dlfcn.h>
+#define LIB_PTR void *
+#else
+#define LIB_PTR void *
+#endif
+
+// Oldest OrtApi version the wrapper runs on (onnxruntime 1.15).
+const uint32_t OrtMinimumApiVersion = 15;
+
+// A global pointer to the OrtApi, set while an OrtRuntime is alive.
+extern const OrtApi *ort_api;
+
+#define CheckORTError(val) (InternalORTErrorCheck((val), #val, __FILE__, __LINE__))
+void InternalORTErrorCheck(OrtStatus *status, const char *text, const char *file, int line);
+
+// CPU arena settings passed to CreateArenaCfgV2. Zero, or -1 for the extend strategy, keeps
+// the ORT default for that setting.
+struct OrtArenaConfig
+{
+    size_t max_mem = 0;
+    // 0 grows the arena in powers of two, 1 by exactly the requested size.
+    int arena_extend_strategy = -1;
+    size_t initial_chunk_size_bytes = 0;
+    size_t max_dead_bytes_per_chunk = 0;
+    size_t initial_growth_chunk_size_bytes = 0;
+};
+
+// Settings of the OrtTensorAllocator registered by OrtEnvConfig::register_tensor_allocator.
+struct OrtTensorAllocatorConfig
+{
+    // Power of two, at least 16 bytes; 64 keeps every block on its own cache lines.
+    size_t alignment = 64;
+    // Blocks of at least this size are mapped in 2MB units; 0 keeps every block on the heap.
+    size_t large_allocation_bytes = 1 << 20;
+    // 0 base pages, 1 transparent hugepages (madvise), 2 explicit MAP_HUGETLB pages falling
+    // back to transparent ones when none are reserved.
+    int huge_pages = 1;
+    // Touch large blocks from the allocating thread so they land on its NUMA node.
+    bool numa_local = true;
+    // Freed large blocks kept for reuse instead of being unmapped.
+    size_t cache_bytes = 64 << 20;
+};
+
+// Counters of the OrtTensorAllocator, see OrtRuntime::TensorAllocatorStats.
+struct OrtTensorAllocatorStats
+{
+    uint64_t allocations = 0;
+    uint64_t large_allocations = 0;
+    // Large blocks by backing: explicit hugetlb pages, transparent hugepages, or base pages
+    // when neither was available.
+    uint64_t hugetlb_blocks = 0;
+    uint64_t transparent_huge_blocks = 0;
+    uint64_t base_page_blocks = 0;
+    uint64_t reused_blocks = 0;
+};
+
+// Environment options applied when the OrtEnv is created. With use_global_thread_pools the
+// env is created with CreateEnvWithGlobalThreadPools and every session created on it runs on
+// that one set of intra/inter-op pools instead of creating its own.
+struct OrtEnvConfig
+{
+    bool use_global_thread_pools = false;
+    int global_intra_op_num_threads = 0;
+    int global_inter_op_num_threads = 0;
+    // -1 keeps the ORT default, 0 disables and 1 enables spinning of idle pool threads.
+    int global_spin_control = -1;
+    // ORT affinity string for the intra-op threads, e.g. "1;2;3" or "1-4;5-8".
+    std::string global_intra_op_thread_affinity;
+    // Register a CPU arena built from cpu_arena on the env. Only sessions loaded with
+    // OrtSessionConfig::use_env_allocators allocate from it; the CPU provider has no other
+    // way to take an arena configuration. Without it, the first such session registers one
+    // with default settings.
+    bool register_cpu_arena = false;
+    OrtArenaConfig cpu_arena;
+    // Register an OrtTensorAllocator on the env instead of an ORT arena. Sessions loaded with
+    // use_env_allocators allocate from it, and so do their wrapper-side input/output buffers.
+    bool register_tensor_allocator = false;
+    OrtTensorAllocatorConfig tensor_allocator;
+};
+
+class OrtModelWeights;
+class OrtTensorAllocator;
+
+// Process-wide owner of the onnxruntime library handle, the OrtApi and the single OrtEnv.
+// Every model holds one reference from Acquire() to Release(); the first reference loads the
+// library, the first InitializeEnvironment creates the env with its config, and the last
+// Release() releases the env and unloads the library.
+class OrtRuntime
+{
+private:
+    static std::mutex mutex;
+    static OrtRuntime *instance;
+
+    LIB_PTR library_ptr;
+    OrtEnv *ort_env;
+    OrtPrepackedWeightsContainer *prepacked_weights;
+    std::map<std::string, std::weak_ptr<const OrtModelWeights>> shared_weights;
+    bool global_thread_pools;
+    bool env_allocator;
+    OrtTensorAllocator *tensor_allocator;
+    size_t ref_count;
+    uint32_t api_version;
+    std::string version_string;
+
+    OrtRuntime();
+    ~OrtRuntime();
+    void RegisterCpuArena(const OrtArenaConfig &config);
+    void RegisterTensorAllocator(const OrtTensorAllocatorConfig &config);
+
+public:
+    static OrtRuntime *Acquire();
+    static void Release();
+    OrtEnv *InitializeEnvironment(const OrtEnvConfig &config);
+    bool UsesGlobalThreadPools() const;
+    // True once a CPU allocator has been registered on the env.
+    bool HasEnvAllocator() const;
+    // Registers a CPU arena with default settings on the env unless one is registered already,
+    // so every session loaded with use_env_allocators shares the same allocator.
+    void EnsureEnvAllocator();
+    // The allocator registered by register_tensor_allocator, or nullptr.
+    OrtAllocator *TensorAllocator() const;
+    // Counters of that allocator; all zero when none is registered.
+    OrtTensorAllocatorStats TensorAllocatorStats() const;
+    // OrtApi version actually obtained from the loaded library.
+    uint32_t ApiVersion() const;
+    const char *VersionString() const;
+    // Container shared by every session loaded with share_prepacked_weights, created on first
+    // use and released with the env.
+    OrtPrepackedWeightsContainer *PrepackedWeightsContainer();
+    // Initializers of the model at modelPath, shared by all sessions holding the returned
+    // pointer and read again once none is left. A rewritten or replaced file (new inode,
+    // size, mtime or ctime, to the nanosecond on Linux) gets its own copy. Empty if the file
+    // cannot be read.
+    std::shared_ptr<const OrtModelWeights> SharedModelWeights(const char *modelPath);
+};
@@ -0,0 +1,160 @@
+#include "OrtSessionPool.h"
+#include <chrono>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static bool PinCurrentThreadToCore(int core)
+{
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#elif __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(core, &cpu_set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    // macOS has no hard affinity; threads stay unpinned.
+    (void)core;
+    return false;
+#endif
+}
+
+OrtSessionPool::OrtSessionPool(const char *modelPath, const OrtSessionPoolConfig &config)
+    : config(config), queue(config.queue_capacity)
+{
+    if (this->config.pool_size == 0)
+        this->config.pool_size = 1;
+    stopping = false;
+    submitting = 0;
+
+    OrtSessionConfig session_config;
+    session_config.intra_op_num_threads = this->config.intra_op_num_threads;
+    session_config.share_prepacked_weights = this->config.share_prepacked_weights;
+    size_t session_count = this->config.share_session ? 1 : this->config.pool_size;
+    for (size_t i = 0; i < session_count; i++)
+    {
+        OrtInference *inference = new OrtInference();
+        inference->LoadONNXRuntimeLibrary();
+        inference->InitializeONNXEnvironment();
+        inference->CreateSessionAndLoadModel(modelPath, session_config);
+        inference->GetInputOutputInfo();
+        if (this->config.warmup)
+            inference->Warmup();
+        sessions.push_back(inference);
+    }
+
+    for (size_t i = 0; i < this->config.pool_size; i++)
+        workers.emplace_back(&OrtSessionPool::WorkerLoop, this, i);
+}
+
+OrtSessionPool::~OrtSessionPool()
+{
+    Stop();
+    for (size_t i = 0; i < sessions.size(); i++)
+        delete sessions[i];
+    sessions.clear();
+}
+
+static void FailStopped(std::promise<std::vector<float>> &result)
+{
+    result.set_exception(std::make_exception_ptr(std::runtime_error("OrtSessionPool is stopped")));
+}
+
+std::future<std::vector<float>> OrtSessionPool::Submit(const float *inputData, size_t inputSize)
+{
+    // A row of another length would make ORT read past the copy or drop its tail.
+    size_t row_element_count = sessions[0]->InputRowElementCount();
+    if (row_element_count == 0 || inputSize != row_element_count * sizeof(float))
+    {
+        std::promise<std::vector<float>> rejected;
+        rejected.set_exception(std::make_exception_ptr(std::invalid_argument("Input size does not match the model's row size")));
+        return rejected.get_future();
+    }
+
+    Task *task = new Task();
+    task->input.assign(inputData, inputData + row_element_count);
+    std::future<std::vector<float>> result = task->result.get_future();
+    // Announce the push before checking stopping: Stop sets stopping before it reads
+    // submitting, so either this call sees stopping or Stop waits for the push to land.
+    submitting++;
+    if (stopping)
+    {
+        submitting--;
+        FailStopped(task->result);
+        delete task;
+        return result;
+    }
+
+    // Back off while the queue is full instead of growing it.
+    task->enqueue_ns = sessions[0]->StageClock();
+    while (!queue.TryPush(task))
+        std::this_thread::yield();
+    submitting--;
+    return result;
+}
+
+// Finishes the queued tasks, then joins the workers. Tasks a worker did not pick up before
+// exiting fail with std::runtime_error.
+void OrtSessionPool::Stop()
+{
+    stopping = true;
+    while (submitting > 0)
+        std::this_thread::yield();
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        if (workers[i].joinable())
+            workers[i].join();
+    }
+    workers.clear();
+
+    Task *task;
+    while (queue.TryPop(task))
+    {
+        FailStopped(task->result);
+        delete task;
+    }
+}
+
+void OrtSessionPool::WorkerLoop(size_t worker_index)
+{
+    if (!config.cores.empty())
+    {
+        int core = config.cores[worker_index % config.cores.size()];
+        if (!PinCurrentThreadToCore(core))
+            printf("Worker %zu could not be pinned to core %d.\n", worker_index, core);
+    }
+
+    const OrtInference *inference = sessions[worker_index % sessions.size()];
+    std::vector<float> output;
+    int idle_count = 0;
+    Task *task;
+
+    while (true)
+    {
+        if (!queue.TryPop(task))
+        {
+            if (stopping)
+                return;
+            // Spin briefly to keep wake-up latency low, then sleep so idle workers free the core.
+            if (idle_count < config.idle_spin_count)
+                idle_count++;
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(config.idle_sleep_us));
+            continue;
+        }
+        idle_count = 0;
+        inference->RecordStage(OrtStageQueueWait, task->enqueue_ns);
+
+        size_t stride = inference->RunBatchInference(task->input.data(), 1, output);
+        // RunBatchInference has printed why the output could not be read.
+        if (stride == 0)
+            task->result.set_exception(std::make_exception_ptr(std::runtime_error("output cannot be read as float")));
+        else
+            task->result.set_value(std::vector<float>(output.begin(), output.begin() + stride));
+        delete task;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "MpmcQueue.h"
+#include "OrtInference.h"
+
+struct OrtSessionPoolConfig
+{
+    size_t pool_size = 1;
+    // Core for worker i is cores[i % cores.size()]; empty leaves workers unpinned.
+    std::vector<int> cores;
+    // Intra-op threads of each session. 1 runs every operator on the pinned worker itself.
+    int intra_op_num_threads = 1;
+    // Share one loaded session between all workers instead of loading pool_size sessions.
+    bool share_session = false;
+    // With separate sessions, keep one copy of the prepacked weights for all of them.
+    bool share_prepacked_weights = true;
+    // Warm up every session before the workers start taking requests.
+    bool warmup = false;
+    size_t queue_capacity = 1024;
+    int idle_spin_count = 2000;
+    int idle_sleep_us = 50;
+};
+
+// Serves single-row requests with pool_size worker threads, each pinned to a core and
+// running its own session (or the shared one). Requests are handed to the workers through
+// a lock-free MPMC queue, and each caller gets its row's outputs through the future.
+class OrtSessionPool
+{
+private:
+    struct Task
+    {
+        std::vector<float> input;
+        std::promise<std::vector<float>> result;
+        uint64_t enqueue_ns;
+    };
+
+    OrtSessionPoolConfig config;
+    std::vector<OrtInference *> sessions;
+    std::vector<std::thread> workers;
+    MpmcQueue<Task *> queue;
+    std::atomic<bool> stopping;
+    // Submit calls between their stopping check and their push; Stop waits for them.
+    std::atomic<size_t> submitting;
+
+    void WorkerLoop(size_t worker_index);
+
+public:
+    OrtSessionPool(const char *modelPath, const OrtSessionPoolConfig &config);
+    ~OrtSessionPool();
+    // inputSize is in bytes and must be one row of the model's input; otherwise the future
+    // holds a std::invalid_argument. After Stop, or when the output has no float form, it
+    // holds a std::runtime_error instead of the outputs.
+    std::future<std::vector<float>> Submit(const float *inputData, size_t inputSize);
+    void Stop();
+};
@@ -0,0 +1,280 @@
+#include "OrtStageMetrics.h"
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <unordered_map>
+
+static std::atomic<uint64_t> next_metrics_id(1);
+
+static int HighestBit(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+        bit++;
+    return bit;
+#endif
+}
+
+// Stores are made only by the shard's own thread, so an increment needs no read-modify-write.
+static void AddRelaxed(std::atomic<uint64_t> &counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+OrtLatencyHistogram::OrtLatencyHistogram()
+    : counts(BucketCount, 0)
+{
+    count = 0;
+    sum_ns = 0;
+    max_ns = 0;
+}
+
+size_t OrtLatencyHistogram::BucketIndex(uint64_t ns)
+{
+    if (ns < SubBucketCount)
+        return (size_t)ns;
+    int exponent = HighestBit(ns);
+    size_t index = (size_t)(exponent - SubBucketBits + 1) * SubBucketCount + ((ns >> (exponent - SubBucketBits)) & (SubBucketCount - 1));
+    return index < BucketCount ? index : BucketCount - 1;
+}
+
+uint64_t OrtLatencyHistogram::BucketLowerBound(size_t index)
+{
+    if (index < SubBucketCount)
+        return index;
+    int exponent = (int)(index / SubBucketCount) + SubBucketBits - 1;
+    return (uint64_t)(SubBucketCount + index % SubBucketCount) << (exponent - SubBucketBits);
+}
+
+double OrtLatencyHistogram::PercentileUs(double fraction) const
+{
+    if (count == 0)
+        return 0;
+    // Nearest rank.
+    uint64_t rank = (uint64_t)ceil(fraction * count);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            double lower = (double)BucketLowerBound(i);
+            double upper = i + 1 < counts.size() ? (double)BucketLowerBound(i + 1) : lower;
+            double value = (lower + upper) / 2;
+            return (value < (double)max_ns ? value : (double)max_ns) / 1000;
+        }
+    }
+    return max_ns / 1000.0;
+}
+
+double OrtLatencyHistogram::MeanUs() const
+{
+    return count > 0 ? (double)sum_ns / count / 1000 : 0;
+}
+
+OrtStageMetrics::Shard::Shard()
+{
+    for (int stage = 0; stage < OrtStageCount; stage++)
+    {
+        for (size_t i = 0; i < OrtLatencyHistogram::BucketCount; i++)
+            counts[stage][i].store(0, std::memory_order_relaxed);
+        sum_ns[stage].store(0, std::memory_order_relaxed);
+        max_ns[stage].store(0, std::memory_order_relaxed);
+    }
+}
+
+OrtStageMetrics::OrtStageMetrics()
+    : shard_set(std::make_shared<ShardSet>())
+{
+    id = next_metrics_id++;
+}
+
+uint64_t OrtStageMetrics::Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The shards a thread records into, one per metrics, returned to their metrics when the
+// thread exits.
+struct OrtStageMetrics::ThreadShards
+{
+    struct Entry
+    {
+        std::weak_ptr<ShardSet> shard_set;
+        Shard *shard;
+    };
+    std::unordered_map<uint64_t, Entry> entries;
+
+    // Entries of destroyed metrics, e.g. of models since reloaded or evicted.
+    void DropExpired()
+    {
+        for (std::unordered_map<uint64_t, Entry>::iterator it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.shard_set.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    ~ThreadShards()
+    {
+        for (std::unordered_map<uint64_t, Entry>::iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            std::shared_ptr<ShardSet> shard_set = it->second.shard_set.lock();
+            if (!shard_set)
+                continue;
+            std::lock_guard<std::mutex> lock(shard_set->mutex);
+            shard_set->free_shards.push_back(it->second.shard);
+        }
+    }
+};
+
+// Metrics ids are never reused, so the cached id cannot match a destroyed OrtStageMetrics.
+// A shard taken over from a finished thread is handed on under the set's mutex, so the new
+// thread continues from the counts the old one stored.
+OrtStageMetrics::Shard *OrtStageMetrics::LocalShard()
+{
+    thread_local uint64_t cached_id = 0;
+    thread_local Shard *cached_shard = nullptr;
+    thread_local ThreadShards thread_shards;
+    if (cached_id == id)
+        return cached_shard;
+
+    std::unordered_map<uint64_t, ThreadShards::Entry>::iterator it = thread_shards.entries.find(id);
+    if (it == thread_shards.entries.end())
+    {
+        thread_shards.DropExpired();
+        ThreadShards::Entry entry;
+        entry.shard_set = shard_set;
+        {
+            std::lock_guard<std::mutex> lock(shard_set->mutex);
+            if (!shard_set->free_shards.empty())
+            {
+                entry.shard = shard_set->free_shards.back();
+                shard_set->free_shards.pop_back();
+            }
+            else
+            {
+                shard_set->shards.emplace_back(new Shard());
+                entry.shard = shard_set->shards.back().get();
+            }
+        }
+        it = thread_shards.entries.insert(std::make_pair(id, entry)).first;
+    }
+    cached_id = id;
+    cached_shard = it->second.shard;
+    return cached_shard;
+}
+
+void OrtStageMetrics::Record(OrtStage stage, uint64_t ns)
+{
+    Shard *shard = LocalShard();
+    AddRelaxed(shard->counts[stage][OrtLatencyHistogram::BucketIndex(ns)], 1);
+    AddRelaxed(shard->sum_ns[stage], ns);
+    if (ns > shard->max_ns[stage].load(std::memory_order_relaxed))
+        shard->max_ns[stage].store(ns, std::memory_order_relaxed);
+}
+
+void OrtStageMetrics::RecordSince(OrtStage stage, uint64_t startNs)
+{
+    uint64_t now = Now();
+    Record(stage, now > startNs ? now - startNs : 0);
+}
+
+OrtStageSnapshot OrtStageMetrics::Snapshot() const
+{
+    OrtStageSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(shard_set->mutex);
+    for (size_t s = 0; s < shard_set->shards.size(); s++)
+    {
+        const Shard &shard = *shard_set->shards[s];
+        for (int stage = 0; stage < OrtStageCount; stage++)
+        {
+            OrtLatencyHistogram &histogram = snapshot.stages[stage];
+            for (size_t i = 0; i < OrtLatencyHistogram::BucketCount; i++)
+            {
+                uint64_t bucket_count = shard.counts[stage][i].load(std::memory_order_relaxed);
+                histogram.counts[i] += bucket_count;
+                histogram.count += bucket_count;
+            }
+            histogram.sum_ns += shard.sum_ns[stage].load(std::memory_order_relaxed);
+            uint64_t max_ns = shard.max_ns[stage].load(std::memory_order_relaxed);
+            if (max_ns > histogram.max_ns)
+                histogram.max_ns = max_ns;
+        }
+    }
+    return snapshot;
+}
+
+const char *OrtStageMetrics::StageName(OrtStage stage)
+{
+    switch (stage)
+    {
+    case OrtStagePrepare:
+        return "prepare";
+    case OrtStageRun:
+        return "run";
+    case OrtStageProcess:
+        return "process";
+    case OrtStageQueueWait:
+        return "queue_wait";
+    default:
+        return "unknown";
+    }
+}
+
+std::string OrtStageMetrics::PrometheusLabel(const char *name, const std::string &value)
+{
+    std::string label = std::string(name) + "=\"";
+    for (size_t i = 0; i < value.size(); i++)
+    {
+        if (value[i] == '\\' || value[i] == '"')
+            label += '\\';
+        if (value[i] == '\n')
+            label += "\\n";
+        else
+            label += value[i];
+    }
+    return label + "\"";
+}
+
+void OrtStageMetrics::AppendPrometheusHeader(std::string &out)
+{
+    out += "# HELP ort_stage_latency_seconds Latency of each inference stage.\n";
+    out += "# TYPE ort_stage_latency_seconds summary\n";
+}
+
+void OrtStageMetrics::AppendPrometheusSamples(std::string &out, const std::string &labels) const
+{
+    static const char *quantile_names[] = {"0.5", "0.99", "0.999"};
+    static const double quantiles[] = {0.5, 0.99, 0.999};
+    OrtStageSnapshot snapshot = Snapshot();
+    char value[64];
+    for (int stage = 0; stage < OrtStageCount; stage++)
+    {
+        const OrtLatencyHistogram &histogram = snapshot.stages[stage];
+        std::string stage_labels = labels + (labels.empty() ? "" : ",") + PrometheusLabel("stage", StageName((OrtStage)stage));
+        for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+        {
+            snprintf(value, sizeof(value), "%.9g", histogram.PercentileUs(quantiles[q]) / 1e6);
+            out += "ort_stage_latency_seconds{" + stage_labels + ",quantile=\"" + quantile_names[q] + "\"} " + value + "\n";
+        }
+        snprintf(value, sizeof(value), "%.9g", histogram.sum_ns / 1e9);
+        out += "ort_stage_latency_seconds_sum{" + stage_labels + "} " + value + "\n";
+        out += "ort_stage_latency_seconds_count{" + stage_labels + "} " + std::to_string((unsigned long long)histogram.count) + "\n";
+    }
+}
+
+std::string OrtStageMetrics::PrometheusText(const std::string &labels) const
+{
+    std::string out;
+    AppendPrometheusHeader(out);
+    AppendPrometheusSamples(out, labels);
+    return out;
+}
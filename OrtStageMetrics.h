@@ -0,0 +1,99 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Stages of a request timed by OrtStageMetrics.
+enum OrtStage
+{
+    OrtStagePrepare,
+    OrtStageRun,
+    OrtStageProcess,
+    OrtStageQueueWait,
+    OrtStageCount
+};
+
+// Aggregated latencies of one stage. Values are kept HDR-style: exact below 32ns, then 32
+// linear sub-buckets per power of two, so any percentile is within about 3% of the true
+// value; the range ends at about 68s, and longer values land in the last bucket.
+class OrtLatencyHistogram
+{
+public:
+    static const int SubBucketBits = 5;
+    static const size_t SubBucketCount = (size_t)1 << SubBucketBits;
+    static const size_t BucketCount = 1024;
+
+    std::vector<uint64_t> counts;
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+
+    OrtLatencyHistogram();
+    static size_t BucketIndex(uint64_t ns);
+    static uint64_t BucketLowerBound(size_t index);
+    // Midpoint of the bucket holding the given fraction (0.5 = p50) of the values, in
+    // microseconds; 0 when empty.
+    double PercentileUs(double fraction) const;
+    double MeanUs() const;
+};
+
+struct OrtStageSnapshot
+{
+    OrtLatencyHistogram stages[OrtStageCount];
+};
+
+// Per-stage latency histograms of one model. Every recording thread writes its own shard
+// with relaxed atomic stores and takes no lock; a thread registers its shard once, on its
+// first Record. Snapshot() sums the shards on demand, so a snapshot taken while others
+// record may miss the values being written at that moment. The shard of a finished thread
+// keeps its counts in the totals and is handed to the next new thread, so there are never
+// more shards than threads recording at once.
+class OrtStageMetrics
+{
+private:
+    struct Shard
+    {
+        std::atomic<uint64_t> counts[OrtStageCount][OrtLatencyHistogram::BucketCount];
+        std::atomic<uint64_t> sum_ns[OrtStageCount];
+        std::atomic<uint64_t> max_ns[OrtStageCount];
+        Shard();
+    };
+
+    // Threads reach the shards through weak pointers, so a thread outliving the metrics
+    // never returns its shard to freed memory.
+    struct ShardSet
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+        // Shards of finished threads.
+        std::vector<Shard *> free_shards;
+    };
+    struct ThreadShards;
+
+    uint64_t id;
+    std::shared_ptr<ShardSet> shard_set;
+
+    Shard *LocalShard();
+
+public:
+    OrtStageMetrics();
+    OrtStageMetrics(const OrtStageMetrics &) = delete;
+    OrtStageMetrics &operator=(const OrtStageMetrics &) = delete;
+    // std::chrono::steady_clock in nanoseconds since its epoch, the time base of RecordSince.
+    static uint64_t Now();
+    void Record(OrtStage stage, uint64_t ns);
+    void RecordSince(OrtStage stage, uint64_t startNs);
+    OrtStageSnapshot Snapshot() const;
+    static const char *StageName(OrtStage stage);
+    // name="value" with the value escaped for the Prometheus text format.
+    static std::string PrometheusLabel(const char *name, const std::string &value);
+    static void AppendPrometheusHeader(std::string &out);
+    // One summary per stage (p50, p99, p999, sum and count in seconds) carrying the given
+    // labels, e.g. PrometheusLabel("model", name).
+    void AppendPrometheusSamples(std::string &out, const std::string &labels) const;
+    std::string PrometheusText(const std::string &labels) const;
+};
@@ -0,0 +1,253 @@
+#include "OrtTensorAllocator.h"
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const size_t HugePageSize = 2 << 20;
+static const size_t BasePageSize = 4096;
+
+static size_t RoundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// NUMA node of the CPU the calling thread runs on, 0 where it cannot be told.
+static int CurrentNumaNode()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return (int)node;
+#endif
+    return 0;
+}
+
+static void *AlignedHeapAlloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void *p = nullptr;
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+#endif
+}
+
+static void AlignedHeapFree(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+OrtTensorAllocator::OrtTensorAllocator(const OrtTensorAllocatorConfig &config)
+    : config(config)
+{
+    static_cast<OrtAllocator &>(*this) = OrtAllocator();
+    version = ORT_API_VERSION;
+    OrtAllocator::Alloc = AllocImpl;
+    OrtAllocator::Free = FreeImpl;
+    OrtAllocator::Info = InfoImpl;
+
+    // The header in front of each block takes one alignment unit, so it has to fit in one.
+    if (this->config.alignment < sizeof(BlockHeader) || (this->config.alignment & (this->config.alignment - 1)) != 0)
+        this->config.alignment = 64;
+    memory_info = nullptr;
+    CheckORTError(ort_api->CreateCpuMemoryInfo(OrtDeviceAllocator, OrtMemTypeDefault, &memory_info));
+    cached_bytes = 0;
+    allocations = 0;
+    large_allocations = 0;
+    hugetlb_blocks = 0;
+    transparent_huge_blocks = 0;
+    base_page_blocks = 0;
+    reused_blocks = 0;
+}
+
+OrtTensorAllocator::~OrtTensorAllocator()
+{
+    for (std::multimap<std::pair<int, size_t>, void *>::iterator it = cached_blocks.begin(); it != cached_blocks.end(); ++it)
+        UnmapLargeBlock(it->second, it->first.second);
+    cached_blocks.clear();
+    if (memory_info)
+        ort_api->ReleaseMemoryInfo(memory_info);
+}
+
+// Each block starts with a BlockHeader one alignment unit before the returned pointer.
+void *OrtTensorAllocator::Allocate(size_t size)
+{
+    allocations++;
+    size_t total_size = size + config.alignment;
+    char *block = nullptr;
+    bool mapped = false;
+    size_t mapped_size = 0;
+    int node = 0;
+#ifdef __linux__
+    if (config.large_allocation_bytes > 0 && size >= config.large_allocation_bytes)
+    {
+        large_allocations++;
+        mapped_size = RoundUp(total_size, HugePageSize);
+        // A cached block stays on the node it was first touched on, so a thread only reuses
+        // the ones placed on its own node.
+        if (config.numa_local)
+            node = CurrentNumaNode();
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            std::multimap<std::pair<int, size_t>, void *>::iterator it = cached_blocks.find(std::make_pair(node, mapped_size));
+            if (it != cached_blocks.end())
+            {
+                block = (char *)it->second;
+                cached_blocks.erase(it);
+                cached_bytes -= mapped_size;
+                reused_blocks++;
+            }
+        }
+        if (!block)
+            block = (char *)MapLargeBlock(mapped_size);
+        mapped = block != nullptr;
+    }
+#endif
+    if (!block)
+        block = (char *)AlignedHeapAlloc(total_size, config.alignment);
+    if (!block)
+        return nullptr;
+
+    BlockHeader *header = (BlockHeader *)(block + config.alignment - sizeof(BlockHeader));
+    header->mapped_size = mapped_size;
+    header->node = node;
+    header->mapped = mapped;
+    return block + config.alignment;
+}
+
+void OrtTensorAllocator::Deallocate(void *p)
+{
+    if (!p)
+        return;
+    char *block = (char *)p - config.alignment;
+    BlockHeader *header = (BlockHeader *)((char *)p - sizeof(BlockHeader));
+    if (!header->mapped)
+    {
+        AlignedHeapFree(block);
+        return;
+    }
+
+    size_t mapped_size = header->mapped_size;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (cached_bytes + mapped_size <= config.cache_bytes)
+        {
+            cached_blocks.insert(std::make_pair(std::make_pair(header->node, mapped_size), (void *)block));
+            cached_bytes += mapped_size;
+            return;
+        }
+    }
+    UnmapLargeBlock(block, mapped_size);
+}
+
+OrtTensorAllocatorStats OrtTensorAllocator::GetStats() const
+{
+    OrtTensorAllocatorStats stats;
+    stats.allocations = allocations.load();
+    stats.large_allocations = large_allocations.load();
+    stats.hugetlb_blocks = hugetlb_blocks.load();
+    stats.transparent_huge_blocks = transparent_huge_blocks.load();
+    stats.base_page_blocks = base_page_blocks.load();
+    stats.reused_blocks = reused_blocks.load();
+    return stats;
+}
+
+// Maps mappedSize bytes (a multiple of 2MB), trying explicit hugetlb pages first when
+// configured, then a 2MB aligned anonymous mapping with MADV_HUGEPAGE, and keeping base
+// pages if the kernel refuses transparent hugepages. Returns nullptr only if mmap fails.
+void *OrtTensorAllocator::MapLargeBlock(size_t mappedSize)
+{
+#ifdef __linux__
+    char *block = nullptr;
+    bool huge = false;
+    bool hugetlb = false;
+#ifdef MAP_HUGETLB
+    if (config.huge_pages == 2)
+    {
+        void *p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            block = (char *)p;
+            huge = true;
+            hugetlb = true;
+            hugetlb_blocks++;
+        }
+    }
+#endif
+    if (!block)
+    {
+        // Over-map by one hugepage and trim, so the block starts on a 2MB boundary and can be
+        // backed by transparent hugepages.
+        size_t reserve_size = mappedSize + HugePageSize;
+        void *p = mmap(nullptr, reserve_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+        char *start = (char *)p;
+        char *aligned = (char *)RoundUp((size_t)start, HugePageSize);
+        if (aligned > start)
+            munmap(start, aligned - start);
+        if (aligned + mappedSize < start + reserve_size)
+            munmap(aligned + mappedSize, start + reserve_size - (aligned + mappedSize));
+        block = aligned;
+#ifdef MADV_HUGEPAGE
+        if (config.huge_pages > 0 && madvise(block, mappedSize, MADV_HUGEPAGE) == 0)
+        {
+            huge = true;
+            transparent_huge_blocks++;
+        }
+#endif
+        if (!huge)
+            base_page_blocks++;
+    }
+
+    // Fault every page in from this thread, so first-touch places the block on the NUMA node
+    // of the thread that asked for it and the run itself takes no page faults. madvise does
+    // not guarantee transparent hugepages, so only hugetlb blocks are touched per 2MB.
+    if (config.numa_local)
+    {
+        size_t stride = hugetlb ? HugePageSize : BasePageSize;
+        for (size_t offset = 0; offset < mappedSize; offset += stride)
+            block[offset] = 0;
+    }
+    return block;
+#else
+    (void)mappedSize;
+    return nullptr;
+#endif
+}
+
+void OrtTensorAllocator::UnmapLargeBlock(void *block, size_t mappedSize)
+{
+#ifdef __linux__
+    munmap(block, mappedSize);
+#else
+    (void)block;
+    (void)mappedSize;
+#endif
+}
+
+void *ORT_API_CALL OrtTensorAllocator::AllocImpl(OrtAllocator *allocator, size_t size)
+{
+    return static_cast<OrtTensorAllocator *>(allocator)->Allocate(size);
+}
+
+void ORT_API_CALL OrtTensorAllocator::FreeImpl(OrtAllocator *allocator, void *p)
+{
+    static_cast<OrtTensorAllocator *>(allocator)->Deallocate(p);
+}
+
+const OrtMemoryInfo *ORT_API_CALL OrtTensorAllocator::InfoImpl(const OrtAllocator *allocator)
+{
+    return static_cast<const OrtTensorAllocator *>(allocator)->memory_info;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "OrtRuntime.h"
+
+// CPU allocator handed to ORT with RegisterAllocator and used for the wrapper's own input
+// and output buffers. Every block is aligned to config.alignment. Blocks of at least
+// large_allocation_bytes are mapped in 2MB units, backed by hugepages as configured, and
+// touched by the allocating thread so that first-touch places them on its NUMA node. Freed
+// large blocks are kept for reuse up to cache_bytes, and with numa_local only handed out
+// again to threads on the node they were placed on. Hugepages and the page-level handling
+// are Linux only; elsewhere every block comes from the aligned heap.
+class OrtTensorAllocator : public OrtAllocator
+{
+private:
+    struct BlockHeader
+    {
+        size_t mapped_size;
+        // NUMA node the block was touched on, 0 without numa_local.
+        int node;
+        bool mapped;
+    };
+
+    OrtTensorAllocatorConfig config;
+    OrtMemoryInfo *memory_info;
+    std::mutex cache_mutex;
+    // Keyed by node and mapped size.
+    std::multimap<std::pair<int, size_t>, void *> cached_blocks;
+    size_t cached_bytes;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> large_allocations;
+    std::atomic<uint64_t> hugetlb_blocks;
+    std::atomic<uint64_t> transparent_huge_blocks;
+    std::atomic<uint64_t> base_page_blocks;
+    std::atomic<uint64_t> reused_blocks;
+
+    static void *ORT_API_CALL AllocImpl(OrtAllocator *allocator, size_t size);
+    static void ORT_API_CALL FreeImpl(OrtAllocator *allocator, void *p);
+    static const OrtMemoryInfo *ORT_API_CALL InfoImpl(const OrtAllocator *allocator);
+    void *MapLargeBlock(size_t mappedSize);
+    void UnmapLargeBlock(void *block, size_t mappedSize);
+
+public:
+    OrtTensorAllocator(const OrtTensorAllocatorConfig &config);
+    OrtTensorAllocator(const OrtTensorAllocator &) = delete;
+    OrtTensorAllocator &operator=(const OrtTensorAllocator &) = delete;
+    ~OrtTensorAllocator();
+    void *Allocate(size_t size);
+    void Deallocate(void *p);
+    OrtTensorAllocatorStats GetStats() const;
+};
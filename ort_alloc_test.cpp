@@ -0,0 +1,202 @@
+#include <errno.h>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "OrtInference.h"
+
+// Counts heap allocations in the steady-state loop (EnableSteadyState, then PrepareInputData,
+// RunInference and ProcessOutput per call) of every model given on the command line.
+// Fails when PrepareInputData allocates, when ProcessOutput allocates with a preallocated
+// output, or when the loop leaves more blocks alive than it started with. The allocations
+// ORT makes inside Run are only reported.
+// ort_alloc_test <model>...; exits with 77 (skipped) when the ORT library cannot be loaded.
+
+static std::atomic<bool> counting(false);
+static std::atomic<long> allocation_count(0);
+static std::atomic<long> live_count(0);
+
+static void CountAllocation(const void *block)
+{
+    if (block && counting.load(std::memory_order_relaxed))
+    {
+        allocation_count++;
+        live_count++;
+    }
+}
+
+static void CountFree(const void *block)
+{
+    if (block && counting.load(std::memory_order_relaxed))
+        live_count--;
+}
+
+#ifdef __GLIBC__
+// Replacing the C allocator also catches operator new, which calls malloc, and ORT's own
+// aligned allocations.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *block, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void *block);
+
+extern "C" void *malloc(size_t size)
+{
+    void *block = __libc_malloc(size);
+    CountAllocation(block);
+    return block;
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    void *block = __libc_calloc(count, size);
+    CountAllocation(block);
+    return block;
+}
+
+extern "C" void *realloc(void *block, size_t size)
+{
+    CountFree(block);
+    void *resized = __libc_realloc(block, size);
+    CountAllocation(resized);
+    return resized;
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    void *block = __libc_memalign(alignment, size);
+    CountAllocation(block);
+    return block;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **block, size_t alignment, size_t size)
+{
+    *block = memalign(alignment, size);
+    return *block ? 0 : ENOMEM;
+}
+
+extern "C" void free(void *block)
+{
+    CountFree(block);
+    __libc_free(block);
+}
+#else
+// Elsewhere only the C++ allocations are seen.
+void *operator new(size_t size)
+{
+    void *block = malloc(size > 0 ? size : 1);
+    if (!block)
+        throw std::bad_alloc();
+    CountAllocation(block);
+    return block;
+}
+
+void operator delete(void *block) noexcept
+{
+    CountFree(block);
+    free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+    operator delete(block);
+}
+#endif
+
+// Allocations per call of each step, averaged over runs calls.
+struct StepCounts
+{
+    double prepare = 0;
+    double run = 0;
+    double process = 0;
+    long live_growth = 0;
+};
+
+static StepCounts CountSteadyState(OrtInferenceContext *context, std::vector<float> &input, size_t runs)
+{
+    StepCounts counts;
+    long prepare = 0;
+    long run = 0;
+    long process = 0;
+    counting = true;
+    long live_start = live_count;
+    for (size_t i = 0; i < runs; i++)
+    {
+        long start = allocation_count;
+        context->PrepareInputData(input.data(), input.size() * sizeof(float));
+        prepare += allocation_count - start;
+        start = allocation_count;
+        context->RunInference();
+        run += allocation_count - start;
+        start = allocation_count;
+        context->ProcessOutput();
+        process += allocation_count - start;
+    }
+    counts.live_growth = live_count - live_start;
+    counting = false;
+    counts.prepare = (double)prepare / runs;
+    counts.run = (double)run / runs;
+    counts.process = (double)process / runs;
+    return counts;
+}
+
+static bool CheckModel(const char *modelPath)
+{
+    OrtSessionConfig config;
+    config.intra_op_num_threads = 1;
+    OrtInference inference;
+    inference.LoadONNXRuntimeLibrary();
+    inference.InitializeONNXEnvironment();
+    inference.CreateSessionAndLoadModel(modelPath, config);
+    inference.GetInputOutputInfo();
+
+    size_t row_element_count = 1;
+    const std::vector<int64_t> &shape = inference.GetInputSignatures()[0].shape;
+    for (size_t j = 1; j < shape.size(); j++)
+        row_element_count *= shape[j] > 0 ? (size_t)shape[j] : 1;
+    std::vector<float> input(row_element_count);
+    for (size_t i = 0; i < input.size(); i++)
+        input[i] = (float)(i % 17) / 17.0f;
+
+    OrtInferenceContext *context = inference.CreateContext();
+    context->EnableSteadyState();
+    // The first calls grow the arena, the stdio buffers and the metrics shards.
+    CountSteadyState(context, input, 20);
+    const size_t runs = 200;
+    StepCounts counts = CountSteadyState(context, input, runs);
+    bool preallocated = context->OutputPreallocated();
+    delete context;
+
+    bool passed = counts.prepare == 0 && (!preallocated || counts.process == 0) && counts.live_growth == 0;
+    printf("%s %s: allocations per call: prepare %.1f, run %.1f (inside ORT), process %.1f (output %s); live blocks %+ld after %zu calls\n",
+           passed ? "PASS" : "FAIL", modelPath, counts.prepare, counts.run, counts.process, preallocated ? "preallocated" : "created by ORT",
+           counts.live_growth, runs);
+    return passed;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <model>...\n", argv[0]);
+        return 1;
+    }
+    // Keeps the runtime loaded across the models, and tells a missing library from a failure.
+    OrtRuntime *runtime = OrtRuntime::Acquire();
+    if (!runtime)
+    {
+        printf("Skipped, the onnxruntime library is not available.\n");
+        return 77;
+    }
+
+    bool passed = true;
+    for (int i = 1; i < argc; i++)
+        passed = CheckModel(argv[i]) && passed;
+    OrtRuntime::Release();
+    return passed ? 0 : 1;
+}
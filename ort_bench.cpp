@@ -0,0 +1,1000 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OrtAsyncInference.h"
+#include "OrtAutoTuner.h"
+#include "OrtBatchScheduler.h"
+#include "OrtInference.h"
+#include "OrtProfileSummary.h"
+#include "OrtReloadableModel.h"
+
+// Benchmarks one model over batch sizes, intra-op thread counts and run modes:
+//   batch      RunBatchInference called back to back from one thread
+//   async      OrtAsyncInference with up to two batches per intra-op thread in flight
+//   scheduler  one client thread per row of the batch submitting single rows to an
+//              OrtBatchScheduler that packs up to batch size rows
+// Further modes, opt-in through --modes, serve or load several models at once; model i is
+// the i-th entry of --model-set (repeated as needed, the benchmarked model by default):
+//   pools      --models models, one client thread per model, with a per-session intra-op
+//              pool of each thread count (pools:session) or one global pool (pools:global)
+//   startup    time to load --models models one after another into one runtime
+//              (startup:shared) and with each model loading the library and env again
+//              (startup:separate); Rows/s is then models loaded per second
+//   mmap       the same loads by path (mmap:path) and from a memory mapping (mmap:mapped),
+//              each set kept loaded for its RSS
+//   cache      the benchmarked model loaded --models times through the optimized-model cache
+//              in --cache-dir, cold (cache:cold, each load optimizes and saves the graph) and
+//              warm (cache:warm, each load reuses the saved graph); -ort saves ORT format
+//   reload     one client thread on an OrtReloadableModel of the benchmarked model, left alone
+//              (reload:steady) and while another thread keeps reloading it (reload:reloading)
+//   mixed      the smallest --batch size with every 20th batch of the largest, on the default
+//              arena (mixed:default), shrinking it after large batches (mixed:shrink), and on an
+//              env arena growing by the requested size (mixed:env-arena)
+//   models     --models models loaded at once, each running every batch size, on arenas of
+//              their own (models:session) or one env arena (models:env)
+// Every configuration is warmed up, then measured repeat times. Throughput and the p50/p99
+// latencies are reported as the mean over the repetitions with a 95% confidence interval;
+// p999 is taken over all repetitions together. The peak RSS is reset before every
+// configuration, so it is that configuration's own peak.
+// --profile enables ORT profiling on the batch, async and scheduler sessions and prints the
+// per-operator summary of each thread count's trace; their timings then include the
+// profiler's overhead.
+//
+// ort_bench <model> [--batch 1,8,32] [--threads 1,2,4]
+//           [--modes batch,async,scheduler,pools,startup,mmap,cache,reload,mixed,models]
+//           [--models 10] [--model-set a.onnx,b.onnx] [--cache-dir dir] [--warmup 50] [--runs 200] [--repeat 5]
+//           [--json file] [--csv file] [--profile prefix]
+
+struct BenchConfig
+{
+    std::string model_path;
+    std::vector<size_t> batch_sizes = {1, 8, 32};
+    std::vector<size_t> thread_counts;
+    std::vector<std::string> modes = {"batch", "async", "scheduler"};
+    size_t model_count = 10;
+    std::vector<std::string> model_set;
+    std::string cache_dir = "ort_bench_cache";
+    size_t warmup = 50;
+    size_t runs = 200;
+    size_t repeat = 5;
+    std::string json_path;
+    std::string csv_path;
+    // Trace file prefix, see OrtSessionConfig::profile_file_prefix. Empty disables profiling.
+    std::string profile_prefix;
+};
+
+struct BenchResult
+{
+    std::string mode;
+    size_t batch_size = 0;
+    size_t threads = 0;
+    size_t models = 1;
+    double throughput_mean = 0;
+    double throughput_ci = 0;
+    double p50_mean_us = 0;
+    double p50_ci_us = 0;
+    double p99_mean_us = 0;
+    double p99_ci_us = 0;
+    double p999_us = 0;
+    size_t rss_bytes = 0;
+    size_t peak_rss_bytes = 0;
+};
+
+// Latencies and wall time of one measured repetition.
+struct BenchSample
+{
+    std::vector<double> latencies_us;
+    double elapsed_us = 0;
+    size_t rows = 0;
+    // RSS at the end of the repetition; 0 reads it when the results are summarized.
+    size_t rss_bytes = 0;
+};
+
+static std::vector<size_t> ParseList(const char *text)
+{
+    std::vector<size_t> values;
+    for (const char *c = text; *c;)
+    {
+        char *end = nullptr;
+        unsigned long value = strtoul(c, &end, 10);
+        if (end == c)
+            break;
+        if (value > 0)
+            values.push_back(value);
+        c = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+static std::vector<std::string> ParseNames(const char *text)
+{
+    std::vector<std::string> names;
+    std::string name;
+    for (const char *c = text;; c++)
+    {
+        if (*c == ',' || *c == '\0')
+        {
+            if (!name.empty())
+                names.push_back(name);
+            name.clear();
+            if (*c == '\0')
+                break;
+        }
+        else
+            name += *c;
+    }
+    return names;
+}
+
+// Current and peak resident set size from /proc/self/status; 0 where it cannot be read.
+static void ReadResidentBytes(size_t &rss, size_t &peakRss)
+{
+    rss = 0;
+    peakRss = 0;
+#ifdef __linux__
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status)
+        return;
+    char line[256];
+    unsigned long long kilobytes;
+    while (fgets(line, sizeof(line), status))
+    {
+        if (sscanf(line, "VmRSS: %llu kB", &kilobytes) == 1)
+            rss = (size_t)kilobytes * 1024;
+        else if (sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1)
+            peakRss = (size_t)kilobytes * 1024;
+    }
+    fclose(status);
+#endif
+}
+
+// Starts a new VmHWM peak at the current RSS (Linux 4.0+), so the peak read afterwards covers
+// one configuration instead of the whole process. Prints once and returns false where the
+// peak cannot be reset; peaks are then process-wide.
+static bool ResetPeakResident()
+{
+    bool reset = false;
+#ifdef __linux__
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs)
+    {
+        reset = fputs("5", clear_refs) >= 0;
+        reset = fclose(clear_refs) == 0 && reset;
+    }
+#endif
+    static bool warned = false;
+    if (!reset && !warned)
+    {
+        printf("Peak RSS cannot be reset here; the peaks reported are process-wide.\n");
+        warned = true;
+    }
+    return reset;
+}
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    // Nearest rank.
+    size_t rank = (size_t)ceil(fraction * values.size());
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+// Two-sided 95% Student t quantile for the given degrees of freedom.
+static double StudentT95(size_t degrees)
+{
+    static const double table[] = {0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degrees == 0)
+        return 0;
+    return degrees < sizeof(table) / sizeof(table[0]) ? table[degrees] : 1.96;
+}
+
+static void MeanAndInterval(const std::vector<double> &values, double &mean, double &interval)
+{
+    mean = 0;
+    interval = 0;
+    if (values.empty())
+        return;
+    for (size_t i = 0; i < values.size(); i++)
+        mean += values[i];
+    mean /= values.size();
+    if (values.size() < 2)
+        return;
+    double variance = 0;
+    for (size_t i = 0; i < values.size(); i++)
+        variance += (values[i] - mean) * (values[i] - mean);
+    variance /= values.size() - 1;
+    interval = StudentT95(values.size() - 1) * sqrt(variance / values.size());
+}
+
+static bool IsServingMode(const std::string &mode)
+{
+    return mode == "batch" || mode == "async" || mode == "scheduler";
+}
+
+static OrtInference *LoadModel(const std::string &modelPath, const OrtSessionConfig &sessionConfig, const OrtEnvConfig &envConfig)
+{
+    OrtInference *inference = new OrtInference();
+    inference->LoadONNXRuntimeLibrary();
+    inference->InitializeONNXEnvironment(envConfig);
+    inference->CreateSessionAndLoadModel(modelPath.c_str(), sessionConfig);
+    inference->GetInputOutputInfo();
+    return inference;
+}
+
+// Ends the session's profiling and prints the per-operator summary of its trace.
+static void PrintProfile(OrtInference &inference, size_t threads)
+{
+    std::string trace_path = inference.EndProfiling();
+    OrtProfileSummary summary;
+    if (trace_path.empty() || !summary.Load(trace_path.c_str()))
+    {
+        printf("No profile for %zu threads.\n", threads);
+        return;
+    }
+    printf("Profile with %zu threads, %s:\n", threads, trace_path.c_str());
+    summary.Print();
+}
+
+static bool HasBenchmarkInput(const OrtInference &inference)
+{
+    const std::vector<OrtTensorSignature> &inputs = inference.GetInputSignatures();
+    if (inputs.size() != 1 || inputs[0].onnx_type != ONNX_TYPE_TENSOR || inputs[0].element_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
+    {
+        printf("Only models with a single float tensor input can be benchmarked.\n");
+        return false;
+    }
+    return true;
+}
+
+// batchSize rows of the same deterministic input on every host, so runs are comparable.
+// False when the model has a fixed batch size other than batchSize.
+static bool MakeInput(const OrtInference &inference, size_t batchSize, std::vector<float> &input)
+{
+    const std::vector<int64_t> &shape = inference.GetInputSignatures()[0].shape;
+    if (!shape.empty() && shape[0] > 0 && (size_t)shape[0] != batchSize)
+        return false;
+    size_t row_element_count = 1;
+    for (size_t j = 1; j < shape.size(); j++)
+        row_element_count *= shape[j] > 0 ? (size_t)shape[j] : 1;
+    input.resize(batchSize * row_element_count);
+    for (size_t i = 0; i < input.size(); i++)
+        input[i] = (float)(i % 17) / 17.0f;
+    return true;
+}
+
+static BenchSample RunBatchMode(const OrtInference &inference, const std::vector<float> &input, size_t batchSize, size_t runs)
+{
+    BenchSample sample;
+    sample.latencies_us.reserve(runs);
+    std::vector<float> output;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t r = 0; r < runs; r++)
+    {
+        uint64_t call_start = OrtStageMetrics::Now();
+        inference.RunBatchInference(input.data(), batchSize, output);
+        sample.latencies_us.push_back((OrtStageMetrics::Now() - call_start) / 1000.0);
+    }
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    sample.rows = runs * batchSize;
+    return sample;
+}
+
+static BenchSample RunAsyncMode(OrtAsyncInference &async, const std::vector<float> &input, size_t batchSize, size_t runs, size_t window)
+{
+    BenchSample sample;
+    sample.latencies_us.assign(runs, 0);
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    size_t in_flight = 0;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t r = 0; r < runs; r++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done_cv.wait(lock, [&] { return in_flight < window; });
+            in_flight++;
+        }
+        uint64_t submit_time = OrtStageMetrics::Now();
+        async.Submit(input.data(), batchSize, [&, r, submit_time](bool, const OrtBatchResult &) {
+            sample.latencies_us[r] = (OrtStageMetrics::Now() - submit_time) / 1000.0;
+            std::lock_guard<std::mutex> lock(mutex);
+            in_flight--;
+            done_cv.notify_one();
+        });
+    }
+    async.Wait();
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    sample.rows = runs * batchSize;
+    return sample;
+}
+
+// batchSize clients each submit runs single rows and wait for every answer in turn.
+static BenchSample RunSchedulerMode(OrtBatchScheduler &scheduler, const std::vector<float> &input, size_t batchSize, size_t runs)
+{
+    BenchSample sample;
+    std::vector<std::vector<double>> client_latencies(batchSize);
+    size_t row_bytes = input.size() / batchSize * sizeof(float);
+    uint64_t start = OrtStageMetrics::Now();
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < batchSize; c++)
+    {
+        clients.emplace_back([&, c] {
+            client_latencies[c].reserve(runs);
+            for (size_t r = 0; r < runs; r++)
+            {
+                uint64_t submit_time = OrtStageMetrics::Now();
+                scheduler.Submit(input.data() + c * (row_bytes / sizeof(float)), row_bytes).get();
+                client_latencies[c].push_back((OrtStageMetrics::Now() - submit_time) / 1000.0);
+            }
+        });
+    }
+    for (size_t c = 0; c < clients.size(); c++)
+        clients[c].join();
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    for (size_t c = 0; c < client_latencies.size(); c++)
+        sample.latencies_us.insert(sample.latencies_us.end(), client_latencies[c].begin(), client_latencies[c].end());
+    sample.rows = runs * batchSize;
+    return sample;
+}
+
+static BenchResult Summarize(const std::string &mode, size_t batchSize, size_t threads, const std::vector<BenchSample> &samples)
+{
+    BenchResult result;
+    result.mode = mode;
+    result.batch_size = batchSize;
+    result.threads = threads;
+    std::vector<double> throughputs;
+    std::vector<double> p50s;
+    std::vector<double> p99s;
+    std::vector<double> all_latencies;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        throughputs.push_back(samples[i].elapsed_us > 0 ? samples[i].rows * 1e6 / samples[i].elapsed_us : 0);
+        p50s.push_back(Percentile(samples[i].latencies_us, 0.5));
+        p99s.push_back(Percentile(samples[i].latencies_us, 0.99));
+        all_latencies.insert(all_latencies.end(), samples[i].latencies_us.begin(), samples[i].latencies_us.end());
+    }
+    MeanAndInterval(throughputs, result.throughput_mean, result.throughput_ci);
+    MeanAndInterval(p50s, result.p50_mean_us, result.p50_ci_us);
+    MeanAndInterval(p99s, result.p99_mean_us, result.p99_ci_us);
+    result.p999_us = Percentile(all_latencies, 0.999);
+    ReadResidentBytes(result.rss_bytes, result.peak_rss_bytes);
+    if (!samples.empty() && samples.back().rss_bytes > 0)
+        result.rss_bytes = samples.back().rss_bytes;
+    return result;
+}
+
+static void PrintResult(const BenchResult &result)
+{
+    printf("%-16s %6zu %7zu %6zu %9.1f +-%4.1f%% %10.1f +-%6.1f %10.1f +-%6.1f %10.1f %10.1f %10.1f\n", result.mode.c_str(), result.batch_size,
+           result.threads, result.models, result.throughput_mean, result.throughput_mean > 0 ? result.throughput_ci / result.throughput_mean * 100 : 0,
+           result.p50_mean_us, result.p50_ci_us, result.p99_mean_us, result.p99_ci_us, result.p999_us, result.rss_bytes / 1048576.0,
+           result.peak_rss_bytes / 1048576.0);
+}
+
+// Loads config.model_count models, model i from model_set[i % size]. Empty if one of them
+// cannot be benchmarked.
+static std::vector<OrtInference *> LoadModelSet(const BenchConfig &config, const OrtSessionConfig &sessionConfig, const OrtEnvConfig &envConfig)
+{
+    std::vector<OrtInference *> models;
+    for (size_t i = 0; i < config.model_count; i++)
+    {
+        models.push_back(LoadModel(config.model_set[i % config.model_set.size()], sessionConfig, envConfig));
+        if (!HasBenchmarkInput(*models.back()))
+        {
+            for (size_t j = 0; j < models.size(); j++)
+                delete models[j];
+            return std::vector<OrtInference *>();
+        }
+    }
+    return models;
+}
+
+// Every model runs runs batches on its own client thread, all at the same time.
+static BenchSample RunModelsConcurrently(const std::vector<OrtInference *> &models, const std::vector<std::vector<float>> &inputs, size_t batchSize,
+                                         size_t runs)
+{
+    BenchSample sample;
+    std::vector<BenchSample> client_samples(models.size());
+    uint64_t start = OrtStageMetrics::Now();
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < models.size(); c++)
+        clients.emplace_back([&, c] { client_samples[c] = RunBatchMode(*models[c], inputs[c], batchSize, runs); });
+    for (size_t c = 0; c < clients.size(); c++)
+        clients[c].join();
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    for (size_t c = 0; c < client_samples.size(); c++)
+    {
+        sample.latencies_us.insert(sample.latencies_us.end(), client_samples[c].latencies_us.begin(), client_samples[c].latencies_us.end());
+        sample.rows += client_samples[c].rows;
+    }
+    return sample;
+}
+
+// pools: the model set served concurrently, once with an intra-op pool of each thread count
+// per session and once with every session on one global pool of that size.
+static void RunPoolsMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    for (size_t t = 0; t < config.thread_counts.size(); t++)
+    {
+        size_t threads = config.thread_counts[t];
+        for (int global = 0; global < 2; global++)
+        {
+            OrtEnvConfig env_config;
+            env_config.use_global_thread_pools = global != 0;
+            env_config.global_intra_op_num_threads = (int)threads;
+            OrtSessionConfig session_config;
+            session_config.intra_op_num_threads = (int)threads;
+            std::vector<OrtInference *> models = LoadModelSet(config, session_config, env_config);
+            if (models.empty())
+                return;
+
+            for (size_t b = 0; b < config.batch_sizes.size(); b++)
+            {
+                size_t batch_size = config.batch_sizes[b];
+                std::vector<std::vector<float>> inputs(models.size());
+                bool accepted = true;
+                for (size_t i = 0; i < models.size(); i++)
+                    accepted = accepted && MakeInput(*models[i], batch_size, inputs[i]);
+                if (!accepted)
+                    continue;
+
+                ResetPeakResident();
+                std::vector<BenchSample> samples;
+                RunModelsConcurrently(models, inputs, batch_size, config.warmup);
+                for (size_t r = 0; r < config.repeat; r++)
+                    samples.push_back(RunModelsConcurrently(models, inputs, batch_size, config.runs));
+                results.push_back(Summarize(global ? "pools:global" : "pools:session", batch_size, threads, samples));
+                results.back().models = models.size();
+                PrintResult(results.back());
+            }
+            for (size_t i = 0; i < models.size(); i++)
+                delete models[i];
+        }
+    }
+}
+
+// Loads the model set one model after another and returns the time of each load, from
+// LoadONNXRuntimeLibrary to GetInputOutputInfo, and the RSS with all of them loaded. With
+// separate, each model is released before the next, so every load also loads the library and
+// creates the env, as every model did before OrtRuntime shared them.
+static BenchSample LoadModelSetTimed(const BenchConfig &config, const OrtSessionConfig &sessionConfig, bool separate)
+{
+    BenchSample sample;
+    std::vector<OrtInference *> models;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t i = 0; i < config.model_count; i++)
+    {
+        uint64_t load_start = OrtStageMetrics::Now();
+        OrtInference *inference = LoadModel(config.model_set[i % config.model_set.size()], sessionConfig, OrtEnvConfig());
+        sample.latencies_us.push_back((OrtStageMetrics::Now() - load_start) / 1000.0);
+        if (separate)
+            delete inference;
+        else
+            models.push_back(inference);
+    }
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    sample.rows = config.model_count;
+    size_t peak_rss;
+    ReadResidentBytes(sample.rss_bytes, peak_rss);
+    for (size_t i = 0; i < models.size(); i++)
+        delete models[i];
+    return sample;
+}
+
+static void RunStartupMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    for (int separate = 0; separate < 2; separate++)
+    {
+        ResetPeakResident();
+        std::vector<BenchSample> samples;
+        // One untimed pass brings the model files into the page cache.
+        if (config.warmup > 0)
+            LoadModelSetTimed(config, OrtSessionConfig(), separate != 0);
+        for (size_t r = 0; r < config.repeat; r++)
+            samples.push_back(LoadModelSetTimed(config, OrtSessionConfig(), separate != 0));
+        results.push_back(Summarize(separate ? "startup:separate" : "startup:shared", 0, 0, samples));
+        results.back().models = config.model_count;
+        PrintResult(results.back());
+    }
+}
+
+// mmap: the model set loaded by path (mmap:path) and from a memory mapping (mmap:mapped),
+// with the runtime held so only the sessions are timed. RSS is taken with every model loaded.
+static void RunMmapMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    if (!OrtRuntime::Acquire())
+        return;
+    for (int mapped = 0; mapped < 2; mapped++)
+    {
+        OrtSessionConfig session_config;
+        session_config.memory_map_model = mapped != 0;
+        ResetPeakResident();
+        std::vector<BenchSample> samples;
+        if (config.warmup > 0)
+            LoadModelSetTimed(config, session_config, false);
+        for (size_t r = 0; r < config.repeat; r++)
+            samples.push_back(LoadModelSetTimed(config, session_config, false));
+        results.push_back(Summarize(mapped ? "mmap:mapped" : "mmap:path", 0, 0, samples));
+        results.back().models = config.model_count;
+        PrintResult(results.back());
+    }
+    OrtRuntime::Release();
+}
+
+// Loads the benchmarked model --models times, one after another, through the optimized-model
+// cache. Cold removes the cached file before every load, so each load optimizes the graph and
+// saves it; warm loads the file left by the loads before.
+static BenchSample LoadCachedModelTimed(const BenchConfig &config, const OrtSessionConfig &sessionConfig, const std::string &cachePath, bool cold)
+{
+    BenchSample sample;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t i = 0; i < config.model_count; i++)
+    {
+        if (cold)
+            remove(cachePath.c_str());
+        uint64_t load_start = OrtStageMetrics::Now();
+        OrtInference *inference = LoadModel(config.model_path, sessionConfig, OrtEnvConfig());
+        sample.latencies_us.push_back((OrtStageMetrics::Now() - load_start) / 1000.0);
+        delete inference;
+    }
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    sample.rows = config.model_count;
+    return sample;
+}
+
+// cache: loads with the optimized-model cache in --cache-dir, cold and warm, with the cache
+// saved as ONNX (cache:cold, cache:warm) and as ORT format (cache:cold-ort, cache:warm-ort).
+static void RunCacheMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    OrtInference runtime_holder;
+    runtime_holder.LoadONNXRuntimeLibrary();
+    for (int ort_format = 0; ort_format < 2; ort_format++)
+    {
+        OrtSessionConfig session_config;
+        session_config.optimized_model_cache_dir = config.cache_dir;
+        session_config.cache_ort_format = ort_format != 0;
+        std::string cache_path = runtime_holder.OptimizedModelCachePath(config.model_path.c_str(), session_config);
+        if (cache_path.empty())
+            return;
+        for (int warm = 0; warm < 2; warm++)
+        {
+            ResetPeakResident();
+            std::vector<BenchSample> samples;
+            if (config.warmup > 0)
+                LoadCachedModelTimed(config, session_config, cache_path, !warm);
+            for (size_t r = 0; r < config.repeat; r++)
+                samples.push_back(LoadCachedModelTimed(config, session_config, cache_path, !warm));
+            std::string mode = std::string(warm ? "cache:warm" : "cache:cold") + (ort_format ? "-ort" : "");
+            results.push_back(Summarize(mode, 0, 0, samples));
+            results.back().models = config.model_count;
+            PrintResult(results.back());
+        }
+        remove(cache_path.c_str());
+    }
+}
+
+// One client thread runs batches back to back on the reloadable model. With reloading, a
+// second thread calls Reload() until the client is done and adds each reload's time to reloadUs.
+static BenchSample RunReloadClient(OrtReloadableModel &model, const std::vector<float> &input, size_t batchSize, size_t runs, bool reloading,
+                                   std::vector<double> &reloadUs)
+{
+    std::atomic<bool> done(false);
+    std::thread reloader;
+    if (reloading)
+    {
+        reloader = std::thread([&] {
+            while (!done)
+            {
+                uint64_t reload_start = OrtStageMetrics::Now();
+                model.Reload();
+                reloadUs.push_back((OrtStageMetrics::Now() - reload_start) / 1000.0);
+            }
+        });
+    }
+
+    BenchSample sample;
+    sample.latencies_us.reserve(runs);
+    std::vector<float> output;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t r = 0; r < runs; r++)
+    {
+        uint64_t call_start = OrtStageMetrics::Now();
+        model.RunBatchInference(input.data(), batchSize, output);
+        sample.latencies_us.push_back((OrtStageMetrics::Now() - call_start) / 1000.0);
+    }
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    sample.rows = runs * batchSize;
+    done = true;
+    if (reloader.joinable())
+        reloader.join();
+    return sample;
+}
+
+// reload: serving latency of an OrtReloadableModel left alone (reload:steady) and while it is
+// reloaded over and over, each new session built and warmed up next to the one serving
+// (reload:reloading).
+static void RunReloadMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    OrtReloadableModel model(config.model_path.c_str());
+    if (!HasBenchmarkInput(*model.Acquire()))
+        return;
+    for (size_t b = 0; b < config.batch_sizes.size(); b++)
+    {
+        size_t batch_size = config.batch_sizes[b];
+        std::vector<float> input;
+        if (!MakeInput(*model.Acquire(), batch_size, input))
+            continue;
+        for (int reloading = 0; reloading < 2; reloading++)
+        {
+            ResetPeakResident();
+            std::vector<double> reload_us;
+            std::vector<BenchSample> samples;
+            RunReloadClient(model, input, batch_size, config.warmup, false, reload_us);
+            for (size_t r = 0; r < config.repeat; r++)
+                samples.push_back(RunReloadClient(model, input, batch_size, config.runs, reloading != 0, reload_us));
+            results.push_back(Summarize(reloading ? "reload:reloading" : "reload:steady", batch_size, 0, samples));
+            PrintResult(results.back());
+            if (reloading)
+                printf("%zu reloads, p50 %.1f us each\n", reload_us.size(), Percentile(reload_us, 0.5));
+        }
+    }
+}
+
+// Every 20th batch has largeBatch rows, the others smallBatch.
+static BenchSample RunMixedBatches(const OrtInference &inference, const std::vector<float> &smallInput, size_t smallBatch,
+                                   const std::vector<float> &largeInput, size_t largeBatch, size_t runs)
+{
+    BenchSample sample;
+    sample.latencies_us.reserve(runs);
+    std::vector<float> output;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t r = 0; r < runs; r++)
+    {
+        bool large = r % 20 == 19;
+        uint64_t call_start = OrtStageMetrics::Now();
+        inference.RunBatchInference(large ? largeInput.data() : smallInput.data(), large ? largeBatch : smallBatch, output);
+        sample.latencies_us.push_back((OrtStageMetrics::Now() - call_start) / 1000.0);
+        sample.rows += large ? largeBatch : smallBatch;
+    }
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    return sample;
+}
+
+// mixed: the benchmarked model serving the smallest --batch size with every 20th batch of the
+// largest, on the default session arena (mixed:default), with the arena shrunk after every
+// large batch (mixed:shrink), and on an env arena that grows by the requested size instead of
+// doubling, also shrunk (mixed:env-arena). RSS is read after the runs, so it is what each setup
+// keeps between large batches; the Batch column is the large size.
+static void RunMixedMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    size_t small_batch = *std::min_element(config.batch_sizes.begin(), config.batch_sizes.end());
+    size_t large_batch = *std::max_element(config.batch_sizes.begin(), config.batch_sizes.end());
+    const char *names[] = {"mixed:default", "mixed:shrink", "mixed:env-arena"};
+    for (int variant = 0; variant < 3; variant++)
+    {
+        OrtEnvConfig env_config;
+        OrtSessionConfig session_config;
+        if (variant > 0)
+            session_config.arena_shrink_batch_size = large_batch;
+        if (variant == 2)
+        {
+            env_config.register_cpu_arena = true;
+            env_config.cpu_arena.arena_extend_strategy = 1;
+            session_config.use_env_allocators = true;
+        }
+        OrtInference *inference = LoadModel(config.model_path, session_config, env_config);
+        std::vector<float> small_input;
+        std::vector<float> large_input;
+        if (!HasBenchmarkInput(*inference) || !MakeInput(*inference, small_batch, small_input) || !MakeInput(*inference, large_batch, large_input))
+        {
+            delete inference;
+            return;
+        }
+
+        ResetPeakResident();
+        std::vector<BenchSample> samples;
+        RunMixedBatches(*inference, small_input, small_batch, large_input, large_batch, config.warmup);
+        for (size_t r = 0; r < config.repeat; r++)
+            samples.push_back(RunMixedBatches(*inference, small_input, small_batch, large_input, large_batch, config.runs));
+        results.push_back(Summarize(names[variant], large_batch, 0, samples));
+        PrintResult(results.back());
+        delete inference;
+    }
+}
+
+// Every model runs runs batches of each --batch size, one model after another.
+static BenchSample RunModelsInTurn(const std::vector<OrtInference *> &models, const std::vector<std::vector<std::vector<float>>> &inputs,
+                                   const std::vector<size_t> &batchSizes, size_t runs)
+{
+    BenchSample sample;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        for (size_t b = 0; b < batchSizes.size(); b++)
+        {
+            if (inputs[i][b].empty())
+                continue;
+            BenchSample batch_sample = RunBatchMode(*models[i], inputs[i][b], batchSizes[b], runs);
+            sample.latencies_us.insert(sample.latencies_us.end(), batch_sample.latencies_us.begin(), batch_sample.latencies_us.end());
+            sample.rows += batch_sample.rows;
+        }
+    }
+    sample.elapsed_us = (OrtStageMetrics::Now() - start) / 1000.0;
+    return sample;
+}
+
+// models: --models models loaded at once, each session with its own CPU arena
+// (models:session) or all of them allocating from one arena registered on the env
+// (models:env). Every model runs every --batch size before the RSS is read, so each
+// arena has grown to its working size.
+static void RunModelsMode(const BenchConfig &config, std::vector<BenchResult> &results)
+{
+    for (int shared = 0; shared < 2; shared++)
+    {
+        OrtEnvConfig env_config;
+        env_config.register_cpu_arena = shared != 0;
+        OrtSessionConfig session_config;
+        session_config.use_env_allocators = shared != 0;
+        ResetPeakResident();
+        std::vector<OrtInference *> models = LoadModelSet(config, session_config, env_config);
+        if (models.empty())
+            return;
+        std::vector<std::vector<std::vector<float>>> inputs(models.size(), std::vector<std::vector<float>>(config.batch_sizes.size()));
+        for (size_t i = 0; i < models.size(); i++)
+        {
+            for (size_t b = 0; b < config.batch_sizes.size(); b++)
+            {
+                if (!MakeInput(*models[i], config.batch_sizes[b], inputs[i][b]))
+                    inputs[i][b].clear();
+            }
+        }
+
+        std::vector<BenchSample> samples;
+        RunModelsInTurn(models, inputs, config.batch_sizes, config.warmup);
+        for (size_t r = 0; r < config.repeat; r++)
+            samples.push_back(RunModelsInTurn(models, inputs, config.batch_sizes, config.runs));
+        results.push_back(Summarize(shared ? "models:env" : "models:session", 0, 0, samples));
+        results.back().models = models.size();
+        PrintResult(results.back());
+        for (size_t i = 0; i < models.size(); i++)
+            delete models[i];
+    }
+}
+
+static std::string JsonString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"' || text[i] == '\\')
+            quoted += '\\';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+static bool WriteJson(const BenchConfig &config, const std::string &machine, const std::vector<BenchResult> &results)
+{
+    FILE *file = fopen(config.json_path.c_str(), "w");
+    if (!file)
+    {
+        printf("Failed to open %s\n", config.json_path.c_str());
+        return false;
+    }
+    fprintf(file, "{\n  \"model\": %s,\n  \"machine\": %s,\n", JsonString(config.model_path).c_str(), JsonString(machine).c_str());
+    fprintf(file, "  \"warmup\": %zu,\n  \"runs\": %zu,\n  \"repeat\": %zu,\n  \"results\": [\n", config.warmup, config.runs, config.repeat);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        fprintf(file, "    {\"mode\": %s, \"batch_size\": %zu, \"threads\": %zu, \"models\": %zu, \"throughput_rows_per_s\": %.3f, \"throughput_ci95\": %.3f, "
+                      "\"p50_us\": %.3f, \"p50_ci95_us\": %.3f, \"p99_us\": %.3f, \"p99_ci95_us\": %.3f, \"p999_us\": %.3f, "
+                      "\"rss_bytes\": %zu, \"peak_rss_bytes\": %zu}%s\n",
+                JsonString(r.mode).c_str(), r.batch_size, r.threads, r.models, r.throughput_mean, r.throughput_ci, r.p50_mean_us, r.p50_ci_us,
+                r.p99_mean_us, r.p99_ci_us, r.p999_us, r.rss_bytes, r.peak_rss_bytes, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
+
+static bool WriteCsv(const BenchConfig &config, const std::vector<BenchResult> &results)
+{
+    FILE *file = fopen(config.csv_path.c_str(), "w");
+    if (!file)
+    {
+        printf("Failed to open %s\n", config.csv_path.c_str());
+        return false;
+    }
+    fprintf(file, "model,mode,batch_size,threads,models,throughput_rows_per_s,throughput_ci95,p50_us,p50_ci95_us,p99_us,p99_ci95_us,p999_us,rss_bytes,peak_rss_bytes\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        fprintf(file, "%s,%s,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%zu,%zu\n", config.model_path.c_str(), r.mode.c_str(), r.batch_size,
+                r.threads, r.models, r.throughput_mean, r.throughput_ci, r.p50_mean_us, r.p50_ci_us, r.p99_mean_us, r.p99_ci_us, r.p999_us,
+                r.rss_bytes, r.peak_rss_bytes);
+    }
+    bool written = !ferror(file);
+    fclose(file);
+    return written;
+}
+
+static bool ParseArguments(int argc, char **argv, BenchConfig &config)
+{
+    if (argc < 2)
+        return false;
+    config.model_path = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "--batch") == 0)
+            config.batch_sizes = ParseList(value);
+        else if (strcmp(argv[i], "--threads") == 0)
+            config.thread_counts = ParseList(value);
+        else if (strcmp(argv[i], "--modes") == 0)
+            config.modes = ParseNames(value);
+        else if (strcmp(argv[i], "--models") == 0)
+            config.model_count = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--model-set") == 0)
+            config.model_set = ParseNames(value);
+        else if (strcmp(argv[i], "--cache-dir") == 0)
+            config.cache_dir = value;
+        else if (strcmp(argv[i], "--warmup") == 0)
+            config.warmup = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--runs") == 0)
+            config.runs = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--repeat") == 0)
+            config.repeat = strtoul(value, nullptr, 10);
+        else if (strcmp(argv[i], "--json") == 0)
+            config.json_path = value;
+        else if (strcmp(argv[i], "--csv") == 0)
+            config.csv_path = value;
+        else if (strcmp(argv[i], "--profile") == 0)
+            config.profile_prefix = value;
+        else
+        {
+            printf("Unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+    if (config.thread_counts.empty())
+    {
+        size_t hardware_threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+        for (size_t count = 1; count < hardware_threads; count *= 2)
+            config.thread_counts.push_back(count);
+        config.thread_counts.push_back(hardware_threads);
+    }
+    if (config.model_set.empty())
+        config.model_set.push_back(config.model_path);
+    return config.runs > 0 && config.repeat > 0 && config.model_count > 0 && !config.batch_sizes.empty();
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    if (!ParseArguments(argc, argv, config))
+    {
+        printf("Usage: %s <model> [--batch 1,8,32] [--threads 1,2,4]\n"
+               "       [--modes batch,async,scheduler,pools,startup,mmap,cache,reload,mixed,models]\n"
+               "       [--models 10] [--model-set a.onnx,b.onnx] [--cache-dir dir] [--warmup 50] [--runs 200] [--repeat 5]\n"
+               "       [--json file] [--csv file] [--profile prefix]\n",
+               argv[0]);
+        return 1;
+    }
+
+    // Held for the serving sweep so the library and env stay loaded between thread counts.
+    OrtRuntime *runtime = OrtRuntime::Acquire();
+    // Acquire has printed why the library could not be loaded.
+    if (!runtime)
+        return 1;
+    std::string machine = OrtAutoTuner::MachineDescription(runtime->VersionString());
+    std::vector<BenchResult> results;
+    printf("%-16s %6s %7s %6s %16s %18s %18s %10s %10s %10s\n", "Mode", "Batch", "Threads", "Models", "Rows/s", "P50(us)", "P99(us)", "P999(us)",
+           "RSS(MB)", "Peak(MB)");
+    bool serving = false;
+    for (size_t m = 0; m < config.modes.size(); m++)
+        serving = serving || IsServingMode(config.modes[m]);
+    for (size_t t = 0; serving && t < config.thread_counts.size(); t++)
+    {
+        size_t threads = config.thread_counts[t];
+        OrtSessionConfig session_config;
+        session_config.intra_op_num_threads = (int)threads;
+        session_config.profile_file_prefix = config.profile_prefix;
+        OrtInference *inference = LoadModel(config.model_path, session_config, OrtEnvConfig());
+        if (!HasBenchmarkInput(*inference))
+        {
+            delete inference;
+            OrtRuntime::Release();
+            return 1;
+        }
+
+        for (size_t b = 0; b < config.batch_sizes.size(); b++)
+        {
+            size_t batch_size = config.batch_sizes[b];
+            std::vector<float> input;
+            if (!MakeInput(*inference, batch_size, input))
+                continue;
+
+            for (size_t m = 0; m < config.modes.size(); m++)
+            {
+                const std::string &mode = config.modes[m];
+                if (!IsServingMode(mode))
+                    continue;
+                std::vector<BenchSample> samples;
+                ResetPeakResident();
+                if (mode == "batch")
+                {
+                    RunBatchMode(*inference, input, batch_size, config.warmup);
+                    for (size_t r = 0; r < config.repeat; r++)
+                        samples.push_back(RunBatchMode(*inference, input, batch_size, config.runs));
+                }
+                else if (mode == "async")
+                {
+                    OrtAsyncInference async(*inference, threads);
+                    size_t window = 2 * threads;
+                    RunAsyncMode(async, input, batch_size, config.warmup, window);
+                    for (size_t r = 0; r < config.repeat; r++)
+                        samples.push_back(RunAsyncMode(async, input, batch_size, config.runs, window));
+                }
+                else
+                {
+                    OrtBatchSchedulerConfig scheduler_config;
+                    scheduler_config.max_batch_size = batch_size;
+                    OrtBatchScheduler scheduler(*inference, scheduler_config);
+                    RunSchedulerMode(scheduler, input, batch_size, config.warmup);
+                    for (size_t r = 0; r < config.repeat; r++)
+                        samples.push_back(RunSchedulerMode(scheduler, input, batch_size, config.runs));
+                }
+                results.push_back(Summarize(mode, batch_size, threads, samples));
+                PrintResult(results.back());
+            }
+        }
+        if (!config.profile_prefix.empty())
+            PrintProfile(*inference, threads);
+        delete inference;
+    }
+    // The multi-model modes set up the env themselves, so nothing may keep it alive.
+    OrtRuntime::Release();
+
+    for (size_t m = 0; m < config.modes.size(); m++)
+    {
+        const std::string &mode = config.modes[m];
+        if (IsServingMode(mode))
+            continue;
+        else if (mode == "pools")
+            RunPoolsMode(config, results);
+        else if (mode == "startup")
+            RunStartupMode(config, results);
+        else if (mode == "mmap")
+            RunMmapMode(config, results);
+        else if (mode == "cache")
+            RunCacheMode(config, results);
+        else if (mode == "reload")
+            RunReloadMode(config, results);
+        else if (mode == "mixed")
+            RunMixedMode(config, results);
+        else if (mode == "models")
+            RunModelsMode(config, results);
+        else
+            printf("Unknown mode %s\n", mode.c_str());
+    }
+
+    printf("Machine: %s\n", machine.c_str());
+    if (!config.json_path.empty() && WriteJson(config, machine, results))
+        printf("Wrote %s\n", config.json_path.c_str());
+    if (!config.csv_path.empty() && WriteCsv(config, results))
+        printf("Wrote %s\n", config.csv_path.c_str());
+    return 0;
+}
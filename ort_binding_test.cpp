@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <vector>
+
+#include "OrtInference.h"
+#include "OrtInferenceBinding.h"
+
+// Binds a batch of rows to caller buffers with OrtInferenceBinding and compares the output
+// RunBatchInference reads with what RunBatchInference returns for the same rows. Fixed-shape
+// tensor outputs must land in their caller buffer; the others are left to ORT. Runs twice
+// with different rows, so a binding that does not reread its input buffer fails.
+// ort_binding_test <model>...; exits with 77 (skipped) when the ORT library cannot be loaded.
+
+// Same conversion as RunBatchInference: numeric tensors as floats, sequences of maps as the
+// values of each map in turn.
+static std::vector<float> ReadFloats(const OrtOutput &output)
+{
+    std::vector<float> values;
+    if (output.Type() == ONNX_TYPE_TENSOR)
+    {
+        OrtTensorView<float> floats = output.AsTensor<float>();
+        OrtTensorView<double> doubles = output.AsTensor<double>();
+        OrtTensorView<int64_t> int64s = output.AsTensor<int64_t>();
+        OrtTensorView<int32_t> int32s = output.AsTensor<int32_t>();
+        values.insert(values.end(), floats.begin(), floats.end());
+        for (size_t i = 0; i < doubles.size(); i++)
+            values.push_back((float)doubles[i]);
+        for (size_t i = 0; i < int64s.size(); i++)
+            values.push_back((float)int64s[i]);
+        for (size_t i = 0; i < int32s.size(); i++)
+            values.push_back((float)int32s[i]);
+    }
+    else if (output.Type() == ONNX_TYPE_SEQUENCE)
+    {
+        for (size_t i = 0; i < output.SequenceLength(); i++)
+        {
+            OrtTensorView<float> row = output.SequenceElement(i).MapValues().AsTensor<float>();
+            values.insert(values.end(), row.begin(), row.end());
+        }
+    }
+    return values;
+}
+
+static bool CheckModel(const char *modelPath)
+{
+    OrtInference inference;
+    inference.LoadONNXRuntimeLibrary();
+    inference.InitializeONNXEnvironment();
+    inference.CreateSessionAndLoadModel(modelPath);
+    inference.GetInputOutputInfo();
+
+    const std::vector<OrtTensorSignature> &outputs = inference.GetOutputSignatures();
+    // The output RunBatchInference reads: the second of two (the classifiers' probabilities),
+    // otherwise the first.
+    size_t checked_output = outputs.size() == 2 ? 1 : 0;
+    size_t row_element_count = inference.InputRowElementCount();
+    const std::vector<int64_t> &input_signature_shape = inference.GetInputSignatures()[0].shape;
+    size_t batch_size = input_signature_shape[0] > 0 ? (size_t)input_signature_shape[0] : 4;
+    std::vector<int64_t> input_shape(input_signature_shape);
+    input_shape[0] = (int64_t)batch_size;
+
+    OrtInferenceBinding binding(inference);
+    std::vector<float> input(batch_size * row_element_count);
+    binding.BindInput(0, input.data(), input.size() * sizeof(float), input_shape);
+
+    std::vector<std::vector<unsigned char>> buffers(outputs.size());
+    std::vector<bool> in_buffer(outputs.size(), false);
+    for (size_t j = 0; j < outputs.size(); j++)
+    {
+        std::vector<int64_t> shape(outputs[j].shape);
+        size_t element_count = 1;
+        bool fixed_shape = outputs[j].onnx_type == ONNX_TYPE_TENSOR && !shape.empty() && OrtElementSize(outputs[j].element_type) > 0;
+        for (size_t k = 0; k < shape.size() && fixed_shape; k++)
+        {
+            if (k == 0)
+                shape[k] = (int64_t)batch_size;
+            fixed_shape = shape[k] > 0;
+            element_count *= (size_t)shape[k];
+        }
+        if (fixed_shape)
+        {
+            buffers[j].resize(element_count * OrtElementSize(outputs[j].element_type));
+            in_buffer[j] = binding.BindOutput(j, buffers[j].data(), buffers[j].size(), shape);
+            if (!in_buffer[j])
+            {
+                printf("FAIL %s: output %zu has a fixed shape but was not bound to its buffer\n", modelPath, j);
+                return false;
+            }
+        }
+        else
+            binding.BindOutput(j);
+    }
+
+    bool passed = true;
+    for (int pass = 0; pass < 2 && passed; pass++)
+    {
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = (float)((i * 7 + pass * 31) % 97) / 97.0f - 0.5f;
+
+        std::vector<float> reference;
+        inference.RunBatchInference(input.data(), batch_size, reference);
+        binding.Run();
+        std::vector<OrtOutput> bound = binding.GetOutputs();
+        std::vector<float> values = ReadFloats(bound[checked_output]);
+        if (reference.empty() || values != reference)
+        {
+            printf("FAIL %s: pass %d, output %zu has %zu values, RunBatchInference %zu, or they differ\n", modelPath, pass, checked_output, values.size(),
+                   reference.size());
+            passed = false;
+        }
+        for (size_t j = 0; j < bound.size() && passed; j++)
+        {
+            if (!in_buffer[j])
+                continue;
+            void *data;
+            CheckORTError(ort_api->GetTensorMutableData(bound[j].Value(), &data));
+            if (data != buffers[j].data())
+            {
+                printf("FAIL %s: output %zu was not written to its buffer\n", modelPath, j);
+                passed = false;
+            }
+        }
+    }
+    if (passed)
+        printf("PASS %s: batch of %zu, output %zu matches RunBatchInference, %zu of %zu outputs in caller buffers\n", modelPath, batch_size,
+               checked_output, (size_t)std::count(in_buffer.begin(), in_buffer.end(), true), outputs.size());
+    return passed;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <model>...\n", argv[0]);
+        return 1;
+    }
+
+    OrtRuntime *runtime = OrtRuntime::Acquire();
+    if (!runtime)
+    {
+        printf("Skipped, the onnxruntime library is not available.\n");
+        return 77;
+    }
+
+    bool passed = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!CheckModel(argv[i]))
+            passed = false;
+    }
+    OrtRuntime::Release();
+    return passed ? 0 : 1;
+}
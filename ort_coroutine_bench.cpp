@@ -0,0 +1,248 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "OrtAwaitable.h"
+
+#ifndef __cpp_impl_coroutine
+#error ort_coroutine_bench needs a compiler with C++20 coroutines.
+#endif
+
+// Serves `concurrency` clients at once, each sending `requests` single-row requests one after
+// another, in two ways:
+//   coroutine   every client is a coroutine awaiting OrtCoroutineModel::Infer, so all of them
+//               share the OrtAsyncInference threads (or ORT's pool with RunAsync)
+//   thread      every client is a thread of its own blocking in RunBatchInference
+// and reports requests/s, the p50/p99 latency, the peak RSS and the threads serving the
+// clients.
+// Every output is compared with a single-threaded RunBatchInference of the same row, so the
+// run also checks the awaitable; it exits with 1 on a mismatch and with 77 (skipped) when the
+// ORT library cannot be loaded.
+// ort_coroutine_bench [model] [--concurrency 16,256,1024] [--requests 50] [--threads 2]
+
+struct ClientStats
+{
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    size_t running = 0;
+    std::vector<double> latencies_us;
+    size_t mismatches = 0;
+
+    void Finish(const std::vector<double> &clientLatencies, size_t clientMismatches)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        latencies_us.insert(latencies_us.end(), clientLatencies.begin(), clientLatencies.end());
+        mismatches += clientMismatches;
+        if (--running == 0)
+            done_cv.notify_all();
+    }
+};
+
+// Fire-and-forget coroutine; completion is reported through ClientStats.
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() { return DetachedTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static DetachedTask CoroutineClient(OrtCoroutineModel &model, const std::vector<float> &row, const std::vector<float> &reference, size_t requests,
+                                    ClientStats &stats)
+{
+    std::vector<double> latencies;
+    size_t mismatches = 0;
+    for (size_t r = 0; r < requests; r++)
+    {
+        uint64_t start = OrtStageMetrics::Now();
+        OrtBatchResult result = co_await model.Infer(row.data(), 1);
+        latencies.push_back((OrtStageMetrics::Now() - start) / 1000.0);
+        if (result.values != reference)
+            mismatches++;
+    }
+    stats.Finish(latencies, mismatches);
+}
+
+static void ThreadClient(const OrtInference &inference, const std::vector<float> &row, const std::vector<float> &reference, size_t requests,
+                         ClientStats &stats)
+{
+    std::vector<double> latencies;
+    std::vector<float> output;
+    size_t mismatches = 0;
+    for (size_t r = 0; r < requests; r++)
+    {
+        uint64_t start = OrtStageMetrics::Now();
+        inference.RunBatchInference(row.data(), 1, output);
+        latencies.push_back((OrtStageMetrics::Now() - start) / 1000.0);
+        if (output != reference)
+            mismatches++;
+    }
+    stats.Finish(latencies, mismatches);
+}
+
+// A "<key>: <value> kB" line of /proc/self/status, 0 where it cannot be read.
+static size_t ReadStatusKilobytes(const char *key)
+{
+    size_t value = 0;
+#ifdef __linux__
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status)
+        return 0;
+    char line[256];
+    size_t key_length = strlen(key);
+    while (fgets(line, sizeof(line), status))
+    {
+        if (strncmp(line, key, key_length) == 0 && line[key_length] == ':')
+            value = (size_t)strtoull(line + key_length + 1, nullptr, 10);
+    }
+    fclose(status);
+#else
+    (void)key;
+#endif
+    return value;
+}
+
+// Restarts VmHWM at the current RSS, so each configuration reports its own peak.
+static void ResetPeakResident()
+{
+#ifdef __linux__
+    FILE *clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs)
+    {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+#endif
+}
+
+static double Percentile(std::vector<double> values, double fraction)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)ceil(fraction * values.size());
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+static std::vector<size_t> ParseList(const char *text)
+{
+    std::vector<size_t> values;
+    for (const char *c = text; *c;)
+    {
+        char *end = nullptr;
+        unsigned long value = strtoul(c, &end, 10);
+        if (end == c)
+            break;
+        if (value > 0)
+            values.push_back(value);
+        c = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+int main(int argc, char **argv)
+{
+    const char *model_path = "./data/svc_iris.onnx";
+    std::vector<size_t> concurrency = {16, 256, 1024};
+    size_t requests = 50;
+    size_t threads = 2;
+    int first_option = 1;
+    if (argc > 1 && strncmp(argv[1], "--", 2) != 0)
+    {
+        model_path = argv[1];
+        first_option = 2;
+    }
+    for (int i = first_option; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--concurrency") == 0)
+            concurrency = ParseList(argv[i + 1]);
+        else if (strcmp(argv[i], "--requests") == 0)
+            requests = strtoul(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = strtoul(argv[i + 1], nullptr, 10);
+        else
+        {
+            printf("Usage: %s [model] [--concurrency 16,256,1024] [--requests 50] [--threads 2]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    OrtRuntime *runtime = OrtRuntime::Acquire();
+    if (!runtime)
+    {
+        printf("Skipped, the onnxruntime library is not available.\n");
+        return 77;
+    }
+
+    // Two or more intra-op threads let OrtAsyncInference use RunAsync where the library has it.
+    OrtSessionConfig session_config;
+    session_config.intra_op_num_threads = (int)threads;
+    OrtInference inference;
+    inference.LoadONNXRuntimeLibrary();
+    inference.InitializeONNXEnvironment();
+    inference.CreateSessionAndLoadModel(model_path, session_config);
+    inference.GetInputOutputInfo();
+
+    size_t row_element_count = 1;
+    const std::vector<int64_t> &shape = inference.GetInputSignatures()[0].shape;
+    for (size_t j = 1; j < shape.size(); j++)
+        row_element_count *= shape[j] > 0 ? (size_t)shape[j] : 1;
+    std::vector<float> row(row_element_count);
+    for (size_t i = 0; i < row.size(); i++)
+        row[i] = (float)(i % 17) / 17.0f;
+    std::vector<float> reference;
+    inference.RunBatchInference(row.data(), 1, reference);
+
+    OrtAsyncInference async(inference, threads);
+    OrtCoroutineModel model(async);
+    size_t mismatches = 0;
+    printf("%-10s %11s %12s %10s %10s %10s %8s\n", "Mode", "Concurrency", "Requests/s", "P50(us)", "P99(us)", "Peak(MB)", "Threads");
+    for (size_t c = 0; c < concurrency.size(); c++)
+    {
+        for (int coroutine = 1; coroutine >= 0; coroutine--)
+        {
+            ClientStats stats;
+            stats.running = concurrency[c];
+            ResetPeakResident();
+            std::vector<std::thread> clients;
+            uint64_t start = OrtStageMetrics::Now();
+            for (size_t i = 0; i < concurrency[c]; i++)
+            {
+                if (coroutine)
+                    CoroutineClient(model, row, reference, requests, stats);
+                else
+                    clients.emplace_back(ThreadClient, std::cref(inference), std::cref(row), std::cref(reference), requests, std::ref(stats));
+            }
+            {
+                std::unique_lock<std::mutex> lock(stats.mutex);
+                stats.done_cv.wait(lock, [&stats] { return stats.running == 0; });
+            }
+            double elapsed_s = (OrtStageMetrics::Now() - start) / 1e9;
+            for (size_t i = 0; i < clients.size(); i++)
+                clients[i].join();
+            if (coroutine)
+                async.Wait();
+
+            mismatches += stats.mismatches;
+            printf("%-10s %11zu %12.1f %10.1f %10.1f %10.1f %8zu\n", coroutine ? "coroutine" : "thread", concurrency[c],
+                   stats.latencies_us.size() / elapsed_s, Percentile(stats.latencies_us, 0.5), Percentile(stats.latencies_us, 0.99),
+                   ReadStatusKilobytes("VmHWM") / 1024.0, coroutine ? threads : concurrency[c]);
+        }
+    }
+    printf("Async path: %s\n", async.UsesRunAsync() ? "RunAsync" : "wrapper threads");
+
+    if (mismatches > 0)
+        printf("FAIL: %zu outputs differ from RunBatchInference\n", mismatches);
+    OrtRuntime::Release();
+    return mismatches > 0 ? 1 : 0;
+}
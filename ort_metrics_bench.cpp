@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "OrtInference.h"
+
+// Measures what the stage metrics cost: the raw Record path, on one thread and on several
+// recording at once, and RunBatchInference on a model loaded with and without them.
+// ort_metrics_bench [model] [batch size] [rounds]
+
+static double RecordCostNs(OrtStageMetrics &metrics, size_t threadCount, size_t recordsPerThread)
+{
+    uint64_t start = OrtStageMetrics::Now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&metrics, recordsPerThread, t] {
+            for (size_t i = 0; i < recordsPerThread; i++)
+                metrics.Record((OrtStage)(i % OrtStageCount), 1000 + (i * 7919 + t) % 200000);
+        });
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    return (double)(OrtStageMetrics::Now() - start) / recordsPerThread;
+}
+
+static OrtInference *LoadModel(const char *modelPath, bool stageMetrics)
+{
+    OrtSessionConfig config;
+    config.stage_metrics = stageMetrics;
+    OrtInference *inference = new OrtInference();
+    inference->LoadONNXRuntimeLibrary();
+    inference->InitializeONNXEnvironment();
+    inference->CreateSessionAndLoadModel(modelPath, config);
+    inference->GetInputOutputInfo();
+    return inference;
+}
+
+static double MeanBatchLatencyUs(const OrtInference &inference, const std::vector<float> &input, size_t batchSize, size_t runs)
+{
+    std::vector<float> output;
+    uint64_t start = OrtStageMetrics::Now();
+    for (size_t r = 0; r < runs; r++)
+        inference.RunBatchInference(input.data(), batchSize, output);
+    return (double)(OrtStageMetrics::Now() - start) / runs / 1000;
+}
+
+int main(int argc, char **argv)
+{
+    const char *model_path = argc > 1 ? argv[1] : "./data/tf_model.onnx";
+    size_t batch_size = argc > 2 ? (size_t)atoi(argv[2]) : 1;
+    size_t rounds = argc > 3 ? (size_t)atoi(argv[3]) : 20;
+
+    const size_t records = 10000000;
+    uint64_t clock_start = OrtStageMetrics::Now();
+    for (size_t i = 0; i < records; i++)
+        OrtStageMetrics::Now();
+    printf("Now(): %.1f ns\n", (double)(OrtStageMetrics::Now() - clock_start) / records);
+    size_t hardware_threads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    for (size_t threads = 1; threads <= hardware_threads * 2; threads *= 2)
+    {
+        OrtStageMetrics metrics;
+        printf("Record, %zu thread(s): %.1f ns per record per thread\n", threads, RecordCostNs(metrics, threads, records / threads));
+    }
+
+    OrtInference *with_metrics = LoadModel(model_path, true);
+    OrtInference *without_metrics = LoadModel(model_path, false);
+    size_t row_element_count = 1;
+    const std::vector<int64_t> &shape = with_metrics->GetInputSignatures()[0].shape;
+    for (size_t j = 1; j < shape.size(); j++)
+        row_element_count *= shape[j] > 0 ? (size_t)shape[j] : 1;
+    std::vector<float> input(batch_size * row_element_count, 0.5f);
+
+    // Alternate the two sessions in short rounds so drift in the machine hits both alike.
+    const size_t runs = 500;
+    MeanBatchLatencyUs(*with_metrics, input, batch_size, runs);
+    MeanBatchLatencyUs(*without_metrics, input, batch_size, runs);
+    std::vector<double> on_latency;
+    std::vector<double> off_latency;
+    for (size_t r = 0; r < rounds; r++)
+    {
+        on_latency.push_back(MeanBatchLatencyUs(*with_metrics, input, batch_size, runs));
+        off_latency.push_back(MeanBatchLatencyUs(*without_metrics, input, batch_size, runs));
+    }
+    std::sort(on_latency.begin(), on_latency.end());
+    std::sort(off_latency.begin(), off_latency.end());
+    double on_median = on_latency[rounds / 2];
+    double off_median = off_latency[rounds / 2];
+    printf("RunBatchInference batch %zu: %.2f us with metrics, %.2f us without (%+.2f%%)\n", batch_size, on_median, off_median,
+           (on_median - off_median) / off_median * 100);
+
+    OrtStageSnapshot snapshot = with_metrics->StageMetrics()->Snapshot();
+    for (int stage = 0; stage < OrtStageCount; stage++)
+    {
+        const OrtLatencyHistogram &histogram = snapshot.stages[stage];
+        printf("%-10s count %llu, p50 %.2f us, p99 %.2f us, p999 %.2f us\n", OrtStageMetrics::StageName((OrtStage)stage),
+               (unsigned long long)histogram.count, histogram.PercentileUs(0.5), histogram.PercentileUs(0.99), histogram.PercentileUs(0.999));
+    }
+    printf("%s", with_metrics->StageMetrics()->PrometheusText(OrtStageMetrics::PrometheusLabel("model", model_path)).c_str());
+
+    delete without_metrics;
+    delete with_metrics;
+    return 0;
+}
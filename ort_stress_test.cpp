@@ -0,0 +1,90 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "OrtInference.h"
+
+// Runs one loaded model from many threads at once, each with its own CreateContext(), and
+// compares every output with the one computed for the same row on a single thread first.
+// ort_stress_test <model> [threads] [calls per thread]; exits with 77 (skipped) when the ORT
+// library cannot be loaded.
+
+static std::vector<float> RunRow(OrtInferenceContext *context, std::vector<float> &row)
+{
+    context->PrepareInputData(row.data(), row.size() * sizeof(float));
+    context->RunInference();
+    context->ProcessOutput();
+    return std::vector<float>(context->output_values, context->output_values + context->output_element_size);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <model> [threads] [calls per thread]\n", argv[0]);
+        return 1;
+    }
+    const char *model_path = argv[1];
+    size_t thread_count = argc > 2 ? (size_t)atoi(argv[2]) : 16;
+    size_t calls = argc > 3 ? (size_t)atoi(argv[3]) : 500;
+
+    OrtRuntime *runtime = OrtRuntime::Acquire();
+    if (!runtime)
+    {
+        printf("Skipped, the onnxruntime library is not available.\n");
+        return 77;
+    }
+
+    OrtInference inference;
+    inference.LoadONNXRuntimeLibrary();
+    inference.InitializeONNXEnvironment();
+    inference.CreateSessionAndLoadModel(model_path);
+    inference.GetInputOutputInfo();
+
+    size_t row_element_count = 1;
+    const std::vector<int64_t> &shape = inference.GetInputSignatures()[0].shape;
+    for (size_t j = 1; j < shape.size(); j++)
+        row_element_count *= shape[j] > 0 ? (size_t)shape[j] : 1;
+
+    // Distinct rows, so a context picking up another thread's input or output shows up.
+    const size_t row_count = 64;
+    std::vector<std::vector<float>> rows(row_count, std::vector<float>(row_element_count));
+    for (size_t r = 0; r < row_count; r++)
+    {
+        for (size_t i = 0; i < row_element_count; i++)
+            rows[r][i] = (float)((r * 31 + i * 7) % 97) / 97.0f - 0.5f;
+    }
+
+    std::vector<std::vector<float>> reference(row_count);
+    OrtInferenceContext *reference_context = inference.CreateContext();
+    for (size_t r = 0; r < row_count; r++)
+        reference[r] = RunRow(reference_context, rows[r]);
+    delete reference_context;
+
+    std::atomic<size_t> mismatches(0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back([&, t] {
+            OrtInferenceContext *context = inference.CreateContext();
+            // Each thread keeps its own copy of the rows, as a caller would own its input.
+            std::vector<std::vector<float>> thread_rows = rows;
+            for (size_t i = 0; i < calls; i++)
+            {
+                size_t r = (i * 13 + t * 7) % row_count;
+                if (RunRow(context, thread_rows[r]) != reference[r])
+                    mismatches++;
+            }
+            delete context;
+        });
+    }
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    bool passed = mismatches == 0;
+    printf("%s %s: %zu threads x %zu calls, %zu outputs differ from the single-threaded reference\n", passed ? "PASS" : "FAIL", model_path,
+           thread_count, calls, mismatches.load());
+    inference.ReleaseONNXRuntime();
+    OrtRuntime::Release();
+    return passed ? 0 : 1;
+}
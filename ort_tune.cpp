@@ -0,0 +1,50 @@
+#include "OrtAutoTuner.h"
+
+// ort_tune <model> <tuning file> [p99|throughput] [batch sizes, e.g. 1,8,32]
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s <model> <tuning file> [p99|throughput] [batch sizes, e.g. 1,8,32]\n", argv[0]);
+        return 1;
+    }
+    const char *model_path = argv[1];
+    const char *tuning_file = argv[2];
+
+    OrtTuningConfig config;
+    if (argc > 3)
+        config.objective = strcmp(argv[3], "throughput") == 0 ? 1 : 0;
+    if (argc > 4)
+    {
+        config.batch_sizes.clear();
+        for (const char *c = argv[4]; *c;)
+        {
+            char *end = nullptr;
+            unsigned long batch_size = strtoul(c, &end, 10);
+            if (end == c)
+                break;
+            if (batch_size > 0)
+                config.batch_sizes.push_back(batch_size);
+            c = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    OrtAutoTuner tuner(config);
+    OrtTuningResult result = tuner.Tune(model_path);
+    if (!result.valid)
+        return 1;
+
+    const OrtSessionConfig &tuned = result.session_config;
+    printf("Machine: %s\n", result.machine.c_str());
+    printf("Candidates: %zu, score %.3f of the defaults (%s)\n", result.candidates, result.score, result.objective == 1 ? "throughput" : "p99");
+    printf("intra_op_num_threads=%d inter_op_num_threads=%d execution_mode=%d graph_optimization_level=%d allow_spinning=%d memory_pattern=%d\n",
+           tuned.intra_op_num_threads, tuned.inter_op_num_threads, tuned.execution_mode, tuned.graph_optimization_level,
+           tuned.allow_spinning, tuned.memory_pattern);
+    for (size_t b = 0; b < result.batch_sizes.size(); b++)
+        printf("batch %zu: p99 %.1f us, %.1f rows/s\n", result.batch_sizes[b], result.p99_latency_us[b], result.throughput[b]);
+
+    if (!OrtAutoTuner::SaveTunedConfig(tuning_file, model_path, result))
+        return 1;
+    printf("Saved to %s\n", tuning_file);
+    return 0;
+}